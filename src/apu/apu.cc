@@ -1,7 +1,9 @@
 #include "apu.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <utility>
 
@@ -9,35 +11,92 @@
 
 namespace audio {
 
-Apu::Apu(std::shared_ptr<mappers::Mapper> mapper)
-    : audio_buffer(),
+Apu::Apu(std::shared_ptr<mappers::Mapper> mapper, uint32_t& pending,
+         events::Scheduler& scheduler)
+    : pending(pending),
+      scheduler(scheduler),
+      audio_buffer(),
       pulse1(PulseChannel::Pulse1),
       pulse2(PulseChannel::Pulse2),
       triangle(),
       noise(),
-      dmc(std::move(mapper)) {}
+      dmc(std::move(mapper), pending, scheduler) {
+  ScheduleSequencer();
+}
 
 void Apu::Tick(uint64_t cycles) {
   while (cycles > 0) {
     cycles--;
 
-    ClockSequencer();
+    if (scheduler.now >= scheduler.Next()) {
+      RunDue();
+    }
 
     // clock channels
     pulse1.Clock();
     pulse2.Clock();
     triangle.Clock();
     noise.Clock();
-    dmc.Clock();
 
     sample_counter += 1.0F;
     if (sample_counter >= SAMPLE_CLOCKS) {
       sample_counter -= SAMPLE_CLOCKS;
       Sample();
     }
+
+    scheduler.now++;
+  }
+}
+
+// The frame sequencer runs before the channels are clocked; the DMC doesn't
+// affect them, so it can run before them as well.
+void Apu::RunDue() {
+  if (scheduler.Deadline(events::TASK_FRAME_SEQUENCER) == scheduler.now) {
+    CatchUpSequencer();
+    ClockSequencer();
+    sequencer_synced++;
+    ScheduleSequencer();
+  }
+
+  if (scheduler.Deadline(events::TASK_DMC) == scheduler.now) {
+    dmc.Run();
   }
 }
 
+void Apu::CatchUpSequencer() {
+  // nothing but counting happened on the skipped cycles
+  uint64_t skipped = scheduler.now - sequencer_synced;
+  half_cycles += skipped;
+
+  if (frame_reset_delay > 0) {
+    frame_reset_delay -= skipped;
+  }
+
+  sequencer_synced = scheduler.now;
+}
+
+void Apu::ScheduleSequencer() {
+  uint64_t next = events::NEVER;
+
+  if (frame_reset_delay > 0) {
+    next = sequencer_synced + frame_reset_delay - 1;
+  }
+
+  // past the last step, as after switching from mode 1 to 0, the sequencer
+  // never steps again
+  const uint64_t* steps = mode0 ? MODE0_STEPS : MODE1_STEPS;
+  int num_steps = mode0 ? std::size(MODE0_STEPS) : std::size(MODE1_STEPS);
+
+  for (int i = 0; i < num_steps; i++) {
+    if (steps[i] >= half_cycles) {
+      next = std::min(next, sequencer_synced + steps[i] - half_cycles);
+      break;
+    }
+  }
+
+  scheduler.Schedule(events::TASK_FRAME_SEQUENCER, next);
+}
+
 void Apu::ClockSequencer() {
   if (frame_reset_delay > 0) {
     frame_reset_delay--;
@@ -78,7 +137,7 @@ void Apu::ModeZeroTick() {
     }
     case STEP4_1: {
       if (!interrupt_inhibit) {
-        frame_interrupt = true;
+        pending |= events::FRAME_IRQ;
       }
       break;
     }
@@ -86,13 +145,13 @@ void Apu::ModeZeroTick() {
       ClockEnvelopesAndLinear();
       ClockLengthAndSweep();
       if (!interrupt_inhibit) {
-        frame_interrupt = true;
+        pending |= events::FRAME_IRQ;
       }
       break;
     }
     case MODE0_RESET: {
       if (!interrupt_inhibit) {
-        frame_interrupt = true;
+        pending |= events::FRAME_IRQ;
       }
       half_cycles = 0;
       break;
@@ -160,11 +219,28 @@ void Apu::Sample() {
   double output = pulse_out + tnd_out;
 
   audio_buffer.push_back(INT16_MAX * (output - 0.5));
+
+  if (audio_buffer.size() >= AUDIO_BUFFER_SIZE) {
+    pending |= events::AUDIO_BUFFER_FULL;
+  }
+}
+
+uint64_t Apu::QuietCycles() {
+  if (dmc.bytes_remaining > 0 || StallCpu() ||
+      audio_buffer.size() >= AUDIO_BUFFER_SIZE) {
+    return 0;
+  }
+
+  // every sample after the next takes more than 40 cycles
+  return (AUDIO_BUFFER_SIZE - audio_buffer.size() - 1) * 40;
 }
 
-bool Apu::AudioBufferFull() { return audio_buffer.size() >= AUDIO_BUFFER_SIZE; }
+bool Apu::AudioBufferFull() {
+  return static_cast<bool>(pending & events::AUDIO_BUFFER_FULL);
+}
 
 std::vector<int16_t> Apu::GetAudioBuffer() {
+  pending &= ~events::AUDIO_BUFFER_FULL;
   return std::exchange(audio_buffer, std::vector<int16_t>());
 }
 
@@ -172,8 +248,8 @@ uint8_t Apu::Read(uint16_t addr) {
   switch (addr) {
     case 0x4015: {
       uint8_t value =
-          (static_cast<uint8_t>(dmc.dmc_interrupt) << 7) |
-          (static_cast<uint8_t>(frame_interrupt) << 6) |
+          (static_cast<uint8_t>((pending & events::DMC_IRQ) != 0) << 7) |
+          (static_cast<uint8_t>((pending & events::FRAME_IRQ) != 0) << 6) |
           /*                                 */ 0 << 5 |
           (static_cast<uint8_t>(dmc.bytes_remaining > 0) << 4) |
           (static_cast<uint8_t>(noise.length_counter.NonZero()) << 3) |
@@ -181,7 +257,7 @@ uint8_t Apu::Read(uint16_t addr) {
           (static_cast<uint8_t>(pulse2.length_counter.NonZero()) << 1) |
           (static_cast<uint8_t>(pulse1.length_counter.NonZero()) << 0);
 
-      frame_interrupt = false;
+      pending &= ~events::FRAME_IRQ;
       return value;
     }
     default:
@@ -219,9 +295,13 @@ void Apu::Write(uint16_t addr, uint8_t value) {
     case 0x4011:
     case 0x4012:
     case 0x4013:
+      dmc.CatchUp();
       dmc.Write(addr, value);
+      dmc.Reschedule();
       break;
     case 0x4015: {
+      dmc.CatchUp();
+
       dmc_enabled = static_cast<bool>(value & 0x10);
       noise_enabled = static_cast<bool>(value & 0x8);
       triangle_enabled = static_cast<bool>(value & 0x4);
@@ -233,11 +313,13 @@ void Apu::Write(uint16_t addr, uint8_t value) {
       triangle.length_counter.SetEnabled(triangle_enabled);
       noise.length_counter.SetEnabled(noise_enabled);
       dmc.SetEnabled(dmc_enabled);
+      dmc.Reschedule();
 
-      dmc.dmc_interrupt = false;
+      pending &= ~events::DMC_IRQ;
       break;
     }
     case 0x4017: {
+      CatchUpSequencer();
       mode0 = (value >> 7) == 0;
       interrupt_inhibit = static_cast<bool>(value & 0x40);
 
@@ -248,9 +330,10 @@ void Apu::Write(uint16_t addr, uint8_t value) {
       }
 
       if (interrupt_inhibit) {
-        frame_interrupt = false;
+        pending &= ~events::FRAME_IRQ;
       }
 
+      ScheduleSequencer();
       break;
     }
   }
@@ -11,6 +11,8 @@
 #include "src/apu/noise.h"
 #include "src/apu/pulse.h"
 #include "src/apu/triangle.h"
+#include "src/events/events.h"
+#include "src/events/scheduler.h"
 #include "src/mappers/mapper.h"
 
 namespace audio {
@@ -23,6 +25,10 @@ constexpr uint64_t STEP4_2 = STEP4_1 + 1;
 constexpr uint64_t STEP5 = 18640 * 2 + 1;
 constexpr uint64_t MODE0_RESET = 14915 * 2;
 constexpr uint64_t MODE1_RESET = 18641 * 2;
+// in order, so that the frame sequencer can find its next deadline
+constexpr uint64_t MODE0_STEPS[] = {STEP1,   STEP2,   STEP3,
+                                    STEP4_1, STEP4_2, MODE0_RESET};
+constexpr uint64_t MODE1_STEPS[] = {STEP1, STEP2, STEP3, STEP5, MODE1_RESET};
 
 constexpr int AUDIO_BUFFER_SIZE = 1024;
 constexpr float CPU_FREQUENCY = 1789773.0F;
@@ -31,7 +37,8 @@ constexpr float SAMPLE_CLOCKS = CPU_FREQUENCY / SAMPLE_RATE;
 
 class Apu {
  public:
-  Apu(std::shared_ptr<mappers::Mapper> mapper);
+  Apu(std::shared_ptr<mappers::Mapper> mapper, uint32_t& pending,
+      events::Scheduler& scheduler);
 
   void Tick(uint64_t cycles);
 
@@ -40,12 +47,17 @@ class Apu {
   bool AudioBufferFull();
   std::vector<int16_t> GetAudioBuffer();
 
-  bool StallCpu() { return dmc.stall_cpu; }
-  bool IrQPending() { return frame_interrupt || dmc.dmc_interrupt; }
+  // A lower bound on the cycles the APU can run from here without stalling
+  // the CPU or filling the audio buffer.
+  uint64_t QuietCycles();
 
-  bool frame_interrupt = false;
+  bool StallCpu() { return static_cast<bool>(pending & events::DMC_STALL); }
+  bool IrQPending() { return static_cast<bool>(pending & events::IRQ); }
 
  private:
+  void RunDue();
+  void CatchUpSequencer();
+  void ScheduleSequencer();
   void ClockSequencer();
   void ModeZeroTick();
   void ModeOneTick();
@@ -54,6 +66,9 @@ class Apu {
 
   void Sample();
 
+  // FRAME_IRQ and AUDIO_BUFFER_FULL bits, see src/events/events.h
+  uint32_t& pending;
+  events::Scheduler& scheduler;
   std::vector<int16_t> audio_buffer;
   Pulse pulse1;
   Pulse pulse2;
@@ -77,6 +92,8 @@ class Apu {
   bool interrupt_inhibit = false;
   float sample_counter = 0.0F;
   int frame_reset_delay = 0;
+  // the first cycle the frame sequencer hasn't run yet
+  uint64_t sequencer_synced = 0;
 };
 
 }  // namespace audio
@@ -1,8 +1,37 @@
 #include "dmc.h"
 
+#include "src/mappers/dispatch.h"
+
 namespace audio {
 
-Dmc::Dmc(std::shared_ptr<mappers::Mapper> mapper) : cartridge(mapper) {}
+Dmc::Dmc(std::shared_ptr<mappers::Mapper> mapper, uint32_t& pending,
+         events::Scheduler& scheduler)
+    : cartridge(mapper), pending(pending), scheduler(scheduler) {
+  Reschedule();
+}
+
+void Dmc::Run() {
+  CatchUp();
+  Clock();
+  synced++;
+  Reschedule();
+}
+
+void Dmc::CatchUp() {
+  // the deadline falls on or before the cycle the timer runs out
+  timer -= scheduler.now - synced;
+  synced = scheduler.now;
+}
+
+void Dmc::Reschedule() {
+  if ((pending & events::DMC_STALL) ||
+      (sample_buffer_emptied && bytes_remaining > 0)) {
+    // clear the stall, or fetch
+    scheduler.Schedule(events::TASK_DMC, synced);
+  } else {
+    scheduler.Schedule(events::TASK_DMC, synced + timer);
+  }
+}
 
 void Dmc::Clock() {
   if (timer == 0) {
@@ -13,10 +42,10 @@ void Dmc::Clock() {
   }
 
   if (sample_buffer_emptied && bytes_remaining > 0) {
-    stall_cpu = true;
+    pending |= events::DMC_STALL;
     NextSampleByte();
   } else {
-    stall_cpu = false;
+    pending &= ~events::DMC_STALL;
   }
 }
 
@@ -59,7 +88,7 @@ void Dmc::NextSampleByte() {
     RestartSample();
   }
 
-  sample_buffer = cartridge->CpuRead(sample_addr);
+  sample_buffer = mappers::CpuRead(*cartridge, sample_addr);
   sample_buffer_emptied = false;
   sample_addr = (sample_addr == 0xFFFF) ? (0x8000) : (sample_addr + 1);
   bytes_remaining--;
@@ -70,7 +99,7 @@ void Dmc::NextSampleByte() {
       RestartSample();
     } else if (irq_enable) {
       // request DMC interrupt
-      dmc_interrupt = true;
+      pending |= events::DMC_IRQ;
     }
   }
 }
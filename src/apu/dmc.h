@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <memory>
 
+#include "src/events/events.h"
+#include "src/events/scheduler.h"
 #include "src/mappers/mapper.h"
 
 namespace audio {
@@ -13,18 +15,22 @@ constexpr uint16_t RATES[16] = {428, 380, 340, 320, 286, 254, 226, 214,
 
 class Dmc {
  public:
-  Dmc(std::shared_ptr<mappers::Mapper> mapper);
-  void Clock();
+  Dmc(std::shared_ptr<mappers::Mapper> mapper, uint32_t& pending,
+      events::Scheduler& scheduler);
+  // Clock on the DMC's deadline, see events::Scheduler.
+  void Run();
+  // Runs the cycles skipped since the last deadline.
+  void CatchUp();
+  void Reschedule();
   uint16_t Volume();
   void Write(uint16_t addr, uint8_t value);
   void SetEnabled(bool value);
 
-  bool dmc_interrupt = false;
-  bool stall_cpu = false;
   bool silence = false;
   uint16_t bytes_remaining = 0x0000;
 
  private:
+  void Clock();
   void ClockOutputCycle();
   void StartNewOutputCycle();
   void NextSampleByte();
@@ -43,8 +49,13 @@ class Dmc {
   uint8_t shift_register = 0x00;
   uint8_t bits_remaining = 0x00;
   bool restart_pending = false;
+  // the first cycle not run yet
+  uint64_t synced = 0;
 
   std::shared_ptr<mappers::Mapper> cartridge;
+  // DMC_IRQ and DMC_STALL bits, see src/events/events.h
+  uint32_t& pending;
+  events::Scheduler& scheduler;
 };
 
 }  // namespace audio
@@ -0,0 +1,64 @@
+#include "breakpoints.h"
+
+#include <cstdint>
+
+namespace cpu {
+
+void Breakpoints::Set(uint16_t addr, uint8_t kinds) {
+  for (uint8_t kind : {WATCH_EXEC, WATCH_READ, WATCH_WRITE}) {
+    if (kinds & kind) {
+      bitmaps[Index(kind)].set(addr);
+    }
+  }
+
+  UpdatePage(addr >> 8);
+}
+
+void Breakpoints::Clear(uint16_t addr, uint8_t kinds) {
+  for (uint8_t kind : {WATCH_EXEC, WATCH_READ, WATCH_WRITE}) {
+    if (kinds & kind) {
+      bitmaps[Index(kind)].reset(addr);
+    }
+  }
+
+  UpdatePage(addr >> 8);
+}
+
+void Breakpoints::ClearAll() {
+  for (auto& bitmap : bitmaps) {
+    bitmap.reset();
+  }
+
+  pages.fill(0);
+  watched_pages = 0;
+
+  for (int page = 0x80; page < 0x100; page++) {
+    UpdatePage(page);
+  }
+}
+
+void Breakpoints::SetCoverage(bool enabled) {
+  coverage = enabled;
+
+  for (int page = 0x80; page < 0x100; page++) {
+    UpdatePage(page);
+  }
+}
+
+void Breakpoints::UpdatePage(uint8_t page) {
+  uint8_t kinds = coverage && page >= 0x80 ? WATCH_COVERAGE : 0;
+
+  for (uint8_t kind : {WATCH_EXEC, WATCH_READ, WATCH_WRITE}) {
+    for (int i = 0; i < 0x100; i++) {
+      if (bitmaps[Index(kind)].test((page << 8) | i)) {
+        kinds |= kind;
+        break;
+      }
+    }
+  }
+
+  watched_pages += (kinds != 0) - (pages[page] != 0);
+  pages[page] = kinds;
+}
+
+}  // namespace cpu
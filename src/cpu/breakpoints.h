@@ -0,0 +1,57 @@
+#ifndef SRC_CPU_BREAKPOINTS_H_
+#define SRC_CPU_BREAKPOINTS_H_
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+namespace cpu {
+
+// Kinds of access a breakpoint stops on; they can be combined.
+constexpr uint8_t WATCH_EXEC = 1 << 0;
+constexpr uint8_t WATCH_READ = 1 << 1;
+constexpr uint8_t WATCH_WRITE = 1 << 2;
+// Set in `pages` on all of 0x8000-0xFFFF while PRG-ROM coverage is being
+// recorded, so that instructions and reads there take the checked path.
+constexpr uint8_t WATCH_COVERAGE = 1 << 3;
+
+struct BreakpointHit {
+  // one of the WATCH_* bits
+  uint8_t kind;
+  uint16_t addr;
+};
+
+/*
+  Execution breakpoints and read/write watchpoints as one bit per address
+  for each kind. The CPU only looks at the bitmaps for addresses on a page
+  that has something of that kind set in `pages`, so a machine with nothing
+  set costs one table lookup per access.
+*/
+class Breakpoints {
+ public:
+  void Set(uint16_t addr, uint8_t kinds);
+  void Clear(uint16_t addr, uint8_t kinds);
+  void ClearAll();
+  void SetCoverage(bool enabled);
+
+  bool Test(uint16_t addr, uint8_t kind) {
+    return bitmaps[Index(kind)].test(addr);
+  }
+  bool Armed() { return watched_pages > 0; }
+
+  // WATCH_* kinds set anywhere on each 256-byte page
+  std::array<uint8_t, 256> pages = {};
+
+ private:
+  // WATCH_EXEC, WATCH_READ and WATCH_WRITE map to 0, 1 and 2
+  static int Index(uint8_t kind) { return kind >> 1; }
+  void UpdatePage(uint8_t page);
+
+  std::array<std::bitset<0x10000>, 3> bitmaps;
+  bool coverage = false;
+  int watched_pages = 0;
+};
+
+}  // namespace cpu
+
+#endif  // SRC_CPU_BREAKPOINTS_H_
@@ -0,0 +1,90 @@
+#include "coverage.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/mappers/mapper.h"
+
+namespace cpu {
+
+Coverage::Coverage(std::shared_ptr<mappers::Mapper> mapper)
+    : rom(std::move(mapper)) {
+  // slots mapped past the end of PRG-ROM get offsets up to Size() + 4K
+  uint64_t words = (rom.Size() + PRG_SLOT_SIZE + 63) / 64;
+  opcodes.resize(words);
+  operands.resize(words);
+  data.resize(words);
+}
+
+void Coverage::Merge(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+
+  if (!in) {
+    return;
+  }
+
+  std::vector<char> log((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+
+  if (log.size() < rom.Size()) {
+    throw "CDL file is smaller than PRG-ROM";
+  }
+
+  for (uint64_t offset = 0; offset < rom.Size(); offset++) {
+    uint8_t flags = static_cast<uint8_t>(log[offset]);
+
+    if (flags & CDL_OPCODE) {
+      Set(opcodes, offset);
+    } else if (flags & CDL_CODE) {
+      Set(operands, offset);
+    }
+
+    if (flags & CDL_DATA) {
+      Set(data, offset);
+    }
+  }
+}
+
+void Coverage::Save(const std::string& path) {
+  std::vector<char> log(rom.Size());
+
+  for (uint64_t offset = 0; offset < rom.Size(); offset++) {
+    uint8_t flags = 0;
+
+    if (Test(opcodes, offset)) {
+      flags |= CDL_CODE | CDL_OPCODE;
+    } else if (Test(operands, offset)) {
+      flags |= CDL_CODE;
+    }
+
+    if (Test(data, offset)) {
+      flags |= CDL_DATA;
+    }
+
+    log[offset] = static_cast<char>(flags);
+  }
+
+  std::ofstream out(path, std::ios::binary);
+
+  if (!out.write(log.data(), log.size())) {
+    throw "Could not write CDL file";
+  }
+}
+
+uint64_t Coverage::Covered() {
+  uint64_t covered = 0;
+
+  for (uint64_t offset = 0; offset < rom.Size(); offset++) {
+    covered += Test(opcodes, offset) || Test(operands, offset) ||
+               Test(data, offset);
+  }
+
+  return covered;
+}
+
+}  // namespace cpu
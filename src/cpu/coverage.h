@@ -0,0 +1,65 @@
+#ifndef SRC_CPU_COVERAGE_H_
+#define SRC_CPU_COVERAGE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/cpu/prg_rom_map.h"
+#include "src/mappers/mapper.h"
+
+namespace cpu {
+
+// Flags of one PRG-ROM byte in a code/data log (CDL) file, as used by FCEUX.
+constexpr uint8_t CDL_CODE = 0x01;
+constexpr uint8_t CDL_DATA = 0x02;
+// Unused by FCEUX. Set on bytes that started an instruction, so that merged
+// logs keep opcodes apart from operands.
+constexpr uint8_t CDL_OPCODE = 0x80;
+
+/*
+  Which PRG-ROM bytes were executed as opcodes, fetched as operands or read
+  as data, one bit per byte each. Coverage from earlier runs can be merged
+  in from a CDL file, and the union saved back.
+*/
+class Coverage {
+ public:
+  Coverage(std::shared_ptr<mappers::Mapper> mapper);
+
+  // An instruction of `length` bytes starting at addr (0x8000-0xFFFF).
+  void Execute(uint16_t addr, uint8_t length) {
+    Set(opcodes, rom.Offset(addr));
+    for (uint8_t i = 1; i < length && addr + i <= 0xFFFF; i++) {
+      Set(operands, rom.Offset(addr + i));
+    }
+  }
+
+  // A data read from addr (0x8000-0xFFFF).
+  void Read(uint16_t addr) { Set(data, rom.Offset(addr)); }
+
+  // ORs in the coverage saved in a CDL file. Missing files are ignored.
+  void Merge(const std::string& path);
+  void Save(const std::string& path);
+
+  uint64_t Size() { return rom.Size(); }
+  // PRG-ROM bytes executed, fetched or read
+  uint64_t Covered();
+
+ private:
+  static void Set(std::vector<uint64_t>& bits, uint64_t offset) {
+    bits[offset >> 6] |= uint64_t{1} << (offset & 63);
+  }
+  static bool Test(const std::vector<uint64_t>& bits, uint64_t offset) {
+    return (bits[offset >> 6] >> (offset & 63)) & 1;
+  }
+
+  PrgRomMap rom;
+  std::vector<uint64_t> opcodes;
+  std::vector<uint64_t> operands;
+  std::vector<uint64_t> data;
+};
+
+}  // namespace cpu
+
+#endif  // SRC_CPU_COVERAGE_H_
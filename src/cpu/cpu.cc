@@ -1,8 +1,9 @@
 #include "cpu.h"
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <cstdio>
-#include <fstream>
 #include <ios>
 #include <iostream>
 #include <sstream>
@@ -10,14 +11,29 @@
 #include <string>
 
 #include "src/cpu/event.h"
+#include "src/events/events.h"
+#include "src/cpu/jit.h"
+#include "src/cpu/opcodes.h"
+#include "src/mappers/cheats.h"
 #include "src/memory/memory.h"
 
 namespace cpu {
 
-Cpu::Cpu(const std::string& path) : mmu(path, p1_input) {
-  myfile.open("emu.log");
+namespace {
+
+bool SameRegisters(const IdleStep& a, const IdleStep& b) {
+  return a.PC == b.PC && a.A == b.A && a.X == b.X && a.Y == b.Y &&
+         a.SP == b.SP && a.P == b.P && a.nz_result == b.nz_result;
 }
 
+}  // namespace
+
+Cpu::Cpu(const std::string& path)
+    : mmu(path, p1_input),
+      ram(mmu.Ram()),
+      decode_cache(mmu.Cartridge()),
+      fetched() {}
+
 void Cpu::Startup() {
   PC = static_cast<uint16_t>(mmu.Read(0xFFFC));
   PC |= static_cast<uint16_t>(mmu.Read(0xFFFD)) << 8;
@@ -28,13 +44,37 @@ Event Cpu::RunTillEvent(uint64_t max_cycles) {
     return Event::Stopped;
   }
 
+  chain_limit = max_cycles;
+
   while (event_cycles < max_cycles) {
     Tick();
 
-    if (mmu.VblankEvent()) {
-      mmu.ClearVBlankEvent();
-      return Event::VBlank;
-    } else if (mmu.apu.AudioBufferFull()) {
+    if (mmu.Pending() &
+        (events::VBLANK | events::AUDIO_BUFFER_FULL | events::BREAKPOINT)) {
+      if (mmu.Pending() & events::BREAKPOINT) {
+        mmu.SetBreakpointEvent(false);
+        return Event::Breakpoint;
+      }
+
+      if (mmu.VblankEvent()) {
+        mmu.ClearVBlankEvent();
+
+        if constexpr (PROFILE_ENABLED) {
+          if (sampler != nullptr) {
+            sampler->EndFrame();
+          }
+        }
+
+        mmu.EndHeatmapFrame();
+
+        if (mmu.SharingState()) {
+          Registers r = GetRegisters();
+          mmu.PublishSharedState({r.PC, r.A, r.X, r.Y, r.SP, r.P, 0}, cycles);
+        }
+
+        return Event::VBlank;
+      }
+
       return Event::AudioBufferFull;
     }
   }
@@ -51,813 +91,471 @@ void Cpu::Run() {
 }
 
 void Cpu::Tick() {
-  if (mmu.InDma()) {
+  uint32_t pending = mmu.Pending();
+
+  if (pending & events::OAM_DMA) {
     RunDma();
     return;
   }
 
   // Check for interrupts
-  if (NmiPending()) {
+  if (pending & events::NMI) {
     mmu.ClearNmi();
     Interrupt(InterruptType::Nmi);
-  } else if (!flag_I && IrqPending()) {
+  } else if ((pending & events::IRQ) && !FlagI()) {
     Interrupt(InterruptType::Irq);
-  } else {
-    DecodeExecute(opcode = Fetch());
+  } else if ((Watched(PC) & (WATCH_EXEC | WATCH_COVERAGE)) &&
+             CheckInstruction()) {
+    return;
+  } else if (idle_state == IdleState::Confirmed && PC == idle_start) {
+    SkipIdleLoop();
+  } else if (jit_mode == JitMode::Off || Observed() || !RunCompiled()) {
+    instructions++;
+    DecodeExecute(opcode = FetchOpcode());
   }
 }
 
-uint8_t* Cpu::GetScreen() { return mmu.GetScreen(); }
+const Profile& Cpu::GetProfile() {
+  profile.Flush(cycles);
+  return profile;
+}
 
-uint8_t* Cpu::GetPatTable1() { return mmu.GetPatTable1(); }
-uint8_t* Cpu::GetPatTable2() { return mmu.GetPatTable2(); }
-uint8_t* Cpu::GetNametable(uint16_t addr) { return mmu.GetNametable(addr); }
-uint8_t* Cpu::GetSprites() { return mmu.GetSprites(); }
-uint8_t* Cpu::GetPalettes() { return mmu.GetPalettes(); }
+void Cpu::StartSampling(uint64_t interval) {
+  if (!PROFILE_ENABLED) {
+    throw "Sampling needs a build with NESEMU_FEATURES_FULL";
+  }
 
-void Cpu::RunDma() {
-  if (dma_state == DmaState::PreDma) {
-    dma_state = cycles % 2 == 1 ? DmaState::OddCycleWait : DmaState::Running;
-  } else if (dma_state == DmaState::OddCycleWait) {
-    dma_state = DmaState::Running;
-  } else {
-    mmu.DmaTick();
+  sampler = std::make_unique<Sampler>(mmu.Cartridge(), interval, cycles);
+}
+
+void Cpu::StartHeatmap(const std::string& path) {
+  if (!features::ENABLED.heatmap) {
+    throw "The heatmap needs a build with NESEMU_FEATURES_FULL";
   }
 
-  AddCycle();
+  mmu.StartHeatmap(path);
+  idle_state = IdleState::Off;
 }
 
-void Cpu::DecodeExecute(uint8_t opcode) {
-  switch (opcode) {
-    case 0x00:
-      BrkImplied();
-      break;
-    case 0x01:
-      OraIndirectX();
-      break;
-    case 0x02:
-      Stp();
-      break;
-    case 0x03:
-      SloIndirectX();
-      break;
-    case 0x04:
-      NopZeroPage();
-      break;
-    case 0x05:
-      OraZeroPage();
-      break;
-    case 0x06:
-      AslZeroPage();
-      break;
-    case 0x07:
-      SloZeroPage();
-      break;
-    case 0x08:
-      PhpImplied();
-      break;
-    case 0x09:
-      OraImmediate();
-      break;
-    case 0x0A:
-      AslAccumulator();
-      break;
-    case 0x0B:
-      AncImmediate();
-      break;
-    case 0x0C:
-      NopAbsolute();
-      break;
-    case 0x0D:
-      OraAbsolute();
-      break;
-    case 0x0E:
-      AslAbsolute();
-      break;
-    case 0x0F:
-      SloAbsolute();
-      break;
-    case 0x10:
-      BplRelative();
-      break;
-    case 0x11:
-      OraIndirectY();
-      break;
-    case 0x12:
-      Stp();
-      break;
-    case 0x13:
-      SloIndirectY();
-      break;
-    case 0x14:
-      NopZeroPageX();
-      break;
-    case 0x15:
-      OraZeroPageX();
-      break;
-    case 0x16:
-      AslZeroPageX();
-      break;
-    case 0x17:
-      SloZeroPageX();
-      break;
-    case 0x18:
-      ClcImplied();
-      break;
-    case 0x19:
-      OraAbsoluteY();
-      break;
-    case 0x1A:
-      NopImplied();
-      break;
-    case 0x1B:
-      SloAbsoluteY();
-      break;
-    case 0x1C:
-      NopAbsoluteX();
-      break;
-    case 0x1D:
-      OraAbsoluteX();
-      break;
-    case 0x1E:
-      AslAbsoluteX();
-      break;
-    case 0x1F:
-      SloAbsoluteX();
-      break;
-    case 0x20:
-      JsrAbsolute();
-      break;
-    case 0x21:
-      AndIndirectX();
-      break;
-    case 0x22:
-      Stp();
-      break;
-    case 0x23:
-      RlaIndirectX();
-      break;
-    case 0x24:
-      BitZeroPage();
-      break;
-    case 0x25:
-      AndZeroPage();
-      break;
-    case 0x26:
-      RolZeroPage();
-      break;
-    case 0x27:
-      RlaZeroPage();
-      break;
-    case 0x28:
-      PlpImplied();
-      break;
-    case 0x29:
-      AndImmediate();
-      break;
-    case 0x2A:
-      RolAccumulator();
-      break;
-    case 0x2B:
-      AncImmediate();
-      break;
-    case 0x2C:
-      BitAbsolute();
-      break;
-    case 0x2D:
-      AndAbsolute();
-      break;
-    case 0x2E:
-      RolAbsolute();
-      break;
-    case 0x2F:
-      RlaAbsolute();
-      break;
-    case 0x30:
-      BmiRelative();
-      break;
-    case 0x31:
-      AndIndirectY();
-      break;
-    case 0x32:
-      Stp();
-      break;
-    case 0x33:
-      RlaIndirectY();
-      break;
-    case 0x34:
-      NopZeroPageX();
-      break;
-    case 0x35:
-      AndZeroPageX();
-      break;
-    case 0x36:
-      RolZeroPageX();
-      break;
-    case 0x37:
-      RlaZeroPageX();
-      break;
-    case 0x38:
-      SecImplied();
-      break;
-    case 0x39:
-      AndAbsoluteY();
-      break;
-    case 0x3A:
-      NopImplied();
-      break;
-    case 0x3B:
-      RlaAbsoluteY();
-      break;
-    case 0x3C:
-      NopAbsoluteX();
-      break;
-    case 0x3D:
-      AndAbsoluteX();
-      break;
-    case 0x3E:
-      RolAbsoluteX();
-      break;
-    case 0x3F:
-      RlaAbsoluteX();
-      break;
-    case 0x40:
-      RtiImplied();
-      break;
-    case 0x41:
-      EorIndirectX();
-      break;
-    case 0x42:
-      Stp();
-      break;
-    case 0x43:
-      SreIndirectX();
-      break;
-    case 0x44:
-      NopZeroPage();
-      break;
-    case 0x45:
-      EorZeroPage();
-      break;
-    case 0x46:
-      LsrZeroPage();
-      break;
-    case 0x47:
-      SreZeroPage();
-      break;
-    case 0x48:
-      PhaImplied();
-      break;
-    case 0x49:
-      EorImmediate();
-      break;
-    case 0x4A:
-      LsrAccumulator();
-      break;
-    case 0x4B:
-      AlrImmediate();
-      break;
-    case 0x4C:
-      JmpAbsolute();
-      break;
-    case 0x4D:
-      EorAbsolute();
-      break;
-    case 0x4E:
-      LsrAbsolute();
-      break;
-    case 0x4F:
-      SreAbsolute();
-      break;
-    case 0x50:
-      BvcRelative();
-      break;
-    case 0x51:
-      EorIndirectY();
-      break;
-    case 0x52:
-      Stp();
-      break;
-    case 0x53:
-      SreIndirectY();
-      break;
-    case 0x54:
-      NopZeroPageX();
-      break;
-    case 0x55:
-      EorZeroPageX();
-      break;
-    case 0x56:
-      LsrZeroPageX();
-      break;
-    case 0x57:
-      SreZeroPageX();
-      break;
-    case 0x58:
-      CliImplied();
-      break;
-    case 0x59:
-      EorAbsoluteY();
-      break;
-    case 0x5A:
-      NopImplied();
-      break;
-    case 0x5B:
-      SreAbsoluteY();
-      break;
-    case 0x5C:
-      NopAbsoluteX();
-      break;
-    case 0x5D:
-      EorAbsoluteX();
-      break;
-    case 0x5E:
-      LsrAbsoluteX();
-      break;
-    case 0x5F:
-      SreAbsoluteX();
-      break;
-    case 0x60:
-      RtsImplied();
-      break;
-    case 0x61:
-      AdcIndirectX();
-      break;
-    case 0x62:
-      Stp();
-      break;
-    case 0x63:
-      RraIndirectX();
-      break;
-    case 0x64:
-      NopZeroPage();
-      break;
-    case 0x65:
-      AdcZeroPage();
-      break;
-    case 0x66:
-      RorZeroPage();
-      break;
-    case 0x67:
-      RraZeroPage();
-      break;
-    case 0x68:
-      PlaImplied();
-      break;
-    case 0x69:
-      AdcImmediate();
-      break;
-    case 0x6A:
-      RorAccumulator();
-      break;
-    case 0x6B:
-      ArrImmediate();
-      break;
-    case 0x6C:
-      JmpIndirect();
-      break;
-    case 0x6D:
-      AdcAbsolute();
-      break;
-    case 0x6E:
-      RorAbsolute();
-      break;
-    case 0x6F:
-      RraAbsolute();
-      break;
-    case 0x70:
-      BvsRelative();
-      break;
-    case 0x71:
-      AdcIndirectY();
-      break;
-    case 0x72:
-      Stp();
-      break;
-    case 0x73:
-      RraIndirectY();
-      break;
-    case 0x74:
-      NopZeroPageX();
-      break;
-    case 0x75:
-      AdcZeroPageX();
-      break;
-    case 0x76:
-      RorZeroPageX();
-      break;
-    case 0x77:
-      RraZeroPageX();
-      break;
-    case 0x78:
-      SeiImplied();
-      break;
-    case 0x79:
-      AdcAbsoluteY();
-      break;
-    case 0x7A:
-      NopImplied();
-      break;
-    case 0x7B:
-      RraAbsoluteY();
-      break;
-    case 0x7C:
-      NopAbsoluteX();
-      break;
-    case 0x7D:
-      AdcAbsoluteX();
-      break;
-    case 0x7E:
-      RorAbsoluteX();
-      break;
-    case 0x7F:
-      RraAbsoluteX();
-      break;
-    case 0x80:
-      NopImmediate();
-      break;
-    case 0x81:
-      StaIndirectX();
-      break;
-    case 0x82:
-      NopImmediate();
-      break;
-    case 0x83:
-      SaxIndirectX();
-      break;
-    case 0x84:
-      StyZeroPage();
-      break;
-    case 0x85:
-      StaZeroPage();
-      break;
-    case 0x86:
-      StxZeroPage();
-      break;
-    case 0x87:
-      SaxZeroPage();
-      break;
-    case 0x88:
-      DeyImplied();
-      break;
-    case 0x89:
-      NopImmediate();
-      break;
-    case 0x8A:
-      TxaImplied();
-      break;
-    case 0x8B:
-      AneImmediate();
-      break;
-    case 0x8C:
-      StyAbsolute();
-      break;
-    case 0x8D:
-      StaAbsolute();
-      break;
-    case 0x8E:
-      StxAbsolute();
-      break;
-    case 0x8F:
-      SaxAbsolute();
-      break;
-    case 0x90:
-      BccRelative();
-      break;
-    case 0x91:
-      StaIndirectY();
-      break;
-    case 0x92:
-      Stp();
-      break;
-    case 0x93:
-      ShaIndirectY();
-      break;
-    case 0x94:
-      StyZeroPageX();
-      break;
-    case 0x95:
-      StaZeroPageX();
-      break;
-    case 0x96:
-      StxZeroPageY();
-      break;
-    case 0x97:
-      SaxZeroPageY();
-      break;
-    case 0x98:
-      TyaImplied();
-      break;
-    case 0x99:
-      StaAbsoluteY();
-      break;
-    case 0x9A:
-      TxsImplied();
-      break;
-    case 0x9B:
-      TasAbsoluteY();
-      break;
-    case 0x9C:
-      ShyAbsoluteX();
-      break;
-    case 0x9D:
-      StaAbsoluteX();
-      break;
-    case 0x9E:
-      ShxAbsoluteY();
-      break;
-    case 0x9F:
-      ShaAbsoluteY();
-      break;
-    case 0xA0:
-      LdyImmediate();
-      break;
-    case 0xA1:
-      LdaIndirectX();
-      break;
-    case 0xA2:
-      LdxImmediate();
-      break;
-    case 0xA3:
-      LaxIndirectX();
-      break;
-    case 0xA4:
-      LdyZeroPage();
-      break;
-    case 0xA5:
-      LdaZeroPage();
-      break;
-    case 0xA6:
-      LdxZeroPage();
-      break;
-    case 0xA7:
-      LaxZeroPage();
-      break;
-    case 0xA8:
-      TayImplied();
-      break;
-    case 0xA9:
-      LdaImmediate();
-      break;
-    case 0xAA:
-      TaxImplied();
-      break;
-    case 0xAB:
-      LxaImmediate();
-      break;
-    case 0xAC:
-      LdyAbsolute();
-      break;
-    case 0xAD:
-      LdaAbsolute();
-      break;
-    case 0xAE:
-      LdxAbsolute();
-      break;
-    case 0xAF:
-      LaxAbsolute();
-      break;
-    case 0xB0:
-      BcsRelative();
-      break;
-    case 0xB1:
-      LdaIndirectY();
-      break;
-    case 0xB2:
-      Stp();
-      break;
-    case 0xB3:
-      LaxIndirectY();
-      break;
-    case 0xB4:
-      LdyZeroPageX();
-      break;
-    case 0xB5:
-      LdaZeroPageX();
-      break;
-    case 0xB6:
-      LdxZeroPageY();
-      break;
-    case 0xB7:
-      LaxZeroPageY();
-      break;
-    case 0xB8:
-      ClvImplied();
-      break;
-    case 0xB9:
-      LdaAbsoluteY();
-      break;
-    case 0xBA:
-      TsxImplied();
-      break;
-    case 0xBB:
-      LasAbsoluteY();
-      break;
-    case 0xBC:
-      LdyAbsoluteX();
-      break;
-    case 0xBD:
-      LdaAbsoluteX();
-      break;
-    case 0xBE:
-      LdxAbsoluteY();
-      break;
-    case 0xBF:
-      LaxAbsoluteY();
-      break;
-    case 0xC0:
-      CpyImmediate();
-      break;
-    case 0xC1:
-      CmpIndirectX();
-      break;
-    case 0xC2:
-      NopImmediate();
-      break;
-    case 0xC3:
-      DcpIndirectX();
-      break;
-    case 0xC4:
-      CpyZeroPage();
-      break;
-    case 0xC5:
-      CmpZeroPage();
-      break;
-    case 0xC6:
-      DecZeroPage();
-      break;
-    case 0xC7:
-      DcpZeroPage();
-      break;
-    case 0xC8:
-      InyImplied();
-      break;
-    case 0xC9:
-      CmpImmediate();
-      break;
-    case 0xCA:
-      DexImplied();
-      break;
-    case 0xCB:
-      SbxImmediate();
-      break;
-    case 0xCC:
-      CpyAbsolute();
-      break;
-    case 0xCD:
-      CmpAbsolute();
-      break;
-    case 0xCE:
-      DecAbsolute();
-      break;
-    case 0xCF:
-      DcpAbsolute();
-      break;
-    case 0xD0:
-      BneRelative();
-      break;
-    case 0xD1:
-      CmpIndirectY();
-      break;
-    case 0xD2:
-      Stp();
-      break;
-    case 0xD3:
-      DcpIndirectY();
-      break;
-    case 0xD4:
-      NopZeroPageX();
-      break;
-    case 0xD5:
-      CmpZeroPageX();
-      break;
-    case 0xD6:
-      DecZeroPageX();
-      break;
-    case 0xD7:
-      DcpZeroPageX();
-      break;
-    case 0xD8:
-      CldImplied();
-      break;
-    case 0xD9:
-      CmpAbsoluteY();
-      break;
-    case 0xDA:
-      NopImplied();
-      break;
-    case 0xDB:
-      DcpAbsoluteY();
-      break;
-    case 0xDC:
-      NopAbsoluteX();
-      break;
-    case 0xDD:
-      CmpAbsoluteX();
-      break;
-    case 0xDE:
-      DecAbsoluteX();
-      break;
-    case 0xDF:
-      DcpAbsoluteX();
-      break;
-    case 0xE0:
-      CpxImmediate();
-      break;
-    case 0xE1:
-      SbcIndirectX();
-      break;
-    case 0xE2:
-      NopImmediate();
-      break;
-    case 0xE3:
-      IscIndirectX();
-      break;
-    case 0xE4:
-      CpxZeroPage();
-      break;
-    case 0xE5:
-      SbcZeroPage();
-      break;
-    case 0xE6:
-      IncZeroPage();
-      break;
-    case 0xE7:
-      IscZeroPage();
-      break;
-    case 0xE8:
-      InxImplied();
-      break;
-    case 0xE9:
-      SbcImmediate();
-      break;
-    case 0xEA:
-      NopImplied();
-      break;
-    case 0xEB:
-      SbcImmediate();
-      break;
-    case 0xEC:
-      CpxAbsolute();
-      break;
-    case 0xED:
-      SbcAbsolute();
-      break;
-    case 0xEE:
-      IncAbsolute();
-      break;
-    case 0xEF:
-      IscAbsolute();
-      break;
-    case 0xF0:
-      BeqRelative();
-      break;
-    case 0xF1:
-      SbcIndirectY();
-      break;
-    case 0xF2:
-      Stp();
-      break;
-    case 0xF3:
-      IscIndirectY();
-      break;
-    case 0xF4:
-      NopZeroPageX();
-      break;
-    case 0xF5:
-      SbcZeroPageX();
-      break;
-    case 0xF6:
-      IncZeroPageX();
-      break;
-    case 0xF7:
-      IscZeroPageX();
-      break;
-    case 0xF8:
-      SedImplied();
-      break;
-    case 0xF9:
-      SbcAbsoluteY();
-      break;
-    case 0xFA:
-      NopImplied();
-      break;
-    case 0xFB:
-      IscAbsoluteY();
-      break;
-    case 0xFC:
-      NopAbsoluteX();
-      break;
-    case 0xFD:
-      SbcAbsoluteX();
-      break;
-    case 0xFE:
-      IncAbsoluteX();
-      break;
-    case 0xFF:
-      IscAbsoluteX();
+void Cpu::SetBreakpoint(uint16_t addr, uint8_t kinds) {
+  if (!features::ENABLED.breakpoints) {
+    throw "Breakpoints are compiled out of lean builds";
+  }
+
+  breakpoints.Set(addr, kinds);
+  idle_state = IdleState::Off;
+}
+
+void Cpu::ClearBreakpoint(uint16_t addr, uint8_t kinds) {
+  breakpoints.Clear(addr, kinds);
+}
+
+Registers Cpu::GetRegisters() { return {PC, A, X, Y, SP, Status()}; }
+
+void Cpu::StartCoverage() {
+  if (!features::ENABLED.breakpoints) {
+    throw "Coverage is compiled out of lean builds";
+  }
+
+  coverage = std::make_unique<Coverage>(mmu.Cartridge());
+  breakpoints.SetCoverage(true);
+  idle_state = IdleState::Off;
+}
+
+void Cpu::AddCheat(const std::string& code) {
+  mmu.Cartridge()->AddCheat(mappers::ParseCheat(code));
+}
+
+void Cpu::StartTrace(const std::string& path) {
+  if (!features::ENABLED.trace) {
+    throw "Tracing is compiled out of lean builds";
+  }
+
+  trace = std::make_unique<Trace>(path);
+  idle_state = IdleState::Off;
+}
+
+void Cpu::SetJitMode(JitMode mode) {
+  if (mode != JitMode::Off && jit == nullptr) {
+    jit = std::make_unique<Jit>(mmu.Cartridge(), mmu.Ram());
+  }
+
+  jit_mode = mode;
+}
+
+uint8_t* Cpu::GetScreen() { return mmu.GetScreen(); }
+
+uint8_t* Cpu::GetPatTable1() { return mmu.GetPatTable1(); }
+uint8_t* Cpu::GetPatTable2() { return mmu.GetPatTable2(); }
+uint8_t* Cpu::GetNametable(uint16_t addr) { return mmu.GetNametable(addr); }
+uint8_t* Cpu::GetSprites() { return mmu.GetSprites(); }
+uint8_t* Cpu::GetPalettes() { return mmu.GetPalettes(); }
+
+void Cpu::RunDma() {
+  if (dma_state == DmaState::PreDma) {
+    if constexpr (PROFILE_ENABLED) {
+      profile.Begin(PROFILE_OAM_DMA, cycles);
+    }
+
+    dma_state = cycles % 2 == 1 ? DmaState::OddCycleWait : DmaState::Running;
+  } else if (dma_state == DmaState::OddCycleWait) {
+    dma_state = DmaState::Running;
+  } else if (event_cycles + memory::OAM_DMA_CYCLES <= chain_limit &&
+             mmu.BulkDma()) {
+    // nothing can happen until the DMA is over, so catch up in one go
+    cycles += memory::OAM_DMA_CYCLES;
+    event_cycles += memory::OAM_DMA_CYCLES;
+    mmu.PpuTick(3 * memory::OAM_DMA_CYCLES);
+    mmu.ApuTick(memory::OAM_DMA_CYCLES);
+    return;
+  } else {
+    mmu.DmaTick();
+  }
+
+  AddCycle();
+}
+
+#if defined(NESEMU_DISPATCH_SWITCH)
+
+void Cpu::DecodeExecute(uint8_t opcode) {
+#define OPCODE_CASE(code, ...) \
+  case code:                   \
+    __VA_ARGS__();             \
+    break;
+
+  switch (opcode) { CPU_OPCODES(OPCODE_CASE) }
+
+#undef OPCODE_CASE
+}
+
+#elif defined(NESEMU_DISPATCH_TABLE)
+
+#define OPCODE_ENTRY(code, ...) &Cpu::__VA_ARGS__,
+const Cpu::Handler Cpu::OPCODE_TABLE[256] = {CPU_OPCODES(OPCODE_ENTRY)};
+#undef OPCODE_ENTRY
+
+void Cpu::DecodeExecute(uint8_t opcode) { (this->*OPCODE_TABLE[opcode])(); }
+
+#elif defined(NESEMU_DISPATCH_COMPUTED_GOTO)
+
+/*
+  Threaded dispatch: every handler ends in its own indirect jump to the next
+  handler, so the branch predictor sees one jump site per opcode instead of a
+  single shared one. Chaining stops whenever RunTillEvent would have done
+  anything other than fetch and execute the next instruction, is off while
+  the JIT is, so that every instruction start goes through Tick, and pauses
+  once an idle loop is found, so that Tick sees it come round again.
+*/
+void Cpu::DecodeExecute(uint8_t opcode) {
+#define OPCODE_LABEL(code, ...) &&op_##code,
+#define OPCODE_BODY(code, ...)                            \
+  op_##code : __VA_ARGS__();                              \
+  if (jit_mode == JitMode::Off &&                         \
+      idle_state != IdleState::Confirmed && CanChain()) { \
+    instructions++;                                       \
+    goto* LABELS[this->opcode = FetchOpcode()];           \
+  }                                                       \
+  return;
+
+  static void* const LABELS[256] = {CPU_OPCODES(OPCODE_LABEL)};
+
+  goto* LABELS[opcode];
+  CPU_OPCODES(OPCODE_BODY)
+
+#undef OPCODE_BODY
+#undef OPCODE_LABEL
+}
+
+#endif
+
+// True if RunTillEvent would go straight on to the next instruction.
+bool Cpu::CanChain() {
+  uint32_t stop = events::OAM_DMA | events::NMI | events::VBLANK |
+                  events::AUDIO_BUFFER_FULL | events::BREAKPOINT |
+                  (FlagI() ? 0 : events::IRQ);
+  return event_cycles < chain_limit && (mmu.Pending() & stop) == 0 &&
+         !(Watched(PC) & (WATCH_EXEC | WATCH_COVERAGE));
+}
+
+/*=================================================================
+*  JIT
+
+   A compiled block runs ahead of the PPU and APU and reports the cycles of
+   every instruction it executed. They are then charged one instruction at a
+   time; if the interpreter would have stopped part way (interrupt, VBlank,
+   full audio buffer, cycle limit), RAM is rolled back and the block is run
+   again, only up to that instruction.
+=================================================================*/
+bool Cpu::RunCompiled() {
+  const JitBlock* block = jit->Find(PC);
+
+  if (block == nullptr) {
+    return false;
+  }
+
+  if constexpr (PROFILE_ENABLED) {
+    profile.Begin(PROFILE_JIT_BLOCK, cycles);
+  }
+
+  JitState entry = SaveJitState();
+  entry.limit = JIT_MAX_INSTRUCTIONS;
+  entry.cycle_budget =
+      event_cycles < chain_limit ? chain_limit - event_cycles : 0;
+
+  JitState state = entry;
+  jit->Run(*block, state);
+
+  if (state.instructions == 0) {
+    return false;
+  }
+
+  uint32_t done = 0;
+  uint32_t charged = 0;
+
+  while (done < state.instructions) {
+    for (; charged < jit->boundaries[done]; charged++) {
+      AddCycle();
+    }
+
+    done++;
+
+    if (!CanChain()) {
       break;
+    }
+  }
+
+  if (done < state.instructions) {
+    jit->Undo(state);
+    state = entry;
+    state.limit = done;
+    jit->Run(*block, state);
+  }
+
+  instructions += done;
+  jit_instructions += done;
+
+  if (jit_mode == JitMode::Check) {
+    CheckCompiled(entry, state);
+  }
+
+  LoadJitState(state);
+  idle_state = IdleState::Off;
+  return true;
+}
+
+/*
+  Runs the instructions of a block again in the interpreter, from the state
+  the block started in, and compares cycles, registers and RAM.
+*/
+void Cpu::CheckCompiled(const JitState& entry, const JitState& compiled) {
+  std::array<uint8_t, 0x800> compiled_ram;
+  std::copy(compiled.ram, compiled.ram + compiled_ram.size(),
+            compiled_ram.begin());
+
+  jit->Undo(compiled);
+  LoadJitState(entry);
+  jit_replay = true;
+
+  for (uint32_t i = 0; i < compiled.instructions; i++) {
+    uint16_t pc = PC;
+    replay_cycles = 0;
+    DecodeExecute(opcode = FetchOpcode());
+
+    uint32_t expected =
+        jit->boundaries[i] - (i > 0 ? jit->boundaries[i - 1] : 0);
+
+    if (replay_cycles != expected) {
+      std::cerr << "JIT: " << expected << " cycles instead of "
+                << replay_cycles << " for opcode 0x" << std::hex
+                << static_cast<int>(opcode) << " at 0x" << pc << std::dec
+                << std::endl;
+      throw "JIT self-check failed";
+    }
+  }
+
+  jit_replay = false;
+  JitState interpreted = SaveJitState();
+
+  if (interpreted.A != compiled.A || interpreted.X != compiled.X ||
+      interpreted.Y != compiled.Y || interpreted.SP != compiled.SP ||
+      interpreted.flag_N != compiled.flag_N ||
+      interpreted.flag_V != compiled.flag_V ||
+      interpreted.flag_D != compiled.flag_D ||
+      interpreted.flag_Z != compiled.flag_Z ||
+      interpreted.flag_C != compiled.flag_C ||
+      interpreted.PC != compiled.PC ||
+      !std::equal(compiled_ram.begin(), compiled_ram.end(), mmu.Ram())) {
+    std::cerr << "JIT: state differs after the block at 0x" << std::hex
+              << entry.PC << std::dec << std::endl;
+    throw "JIT self-check failed";
+  }
+}
+
+JitState Cpu::SaveJitState() {
+  JitState state = {};
+  state.A = A;
+  state.X = X;
+  state.Y = Y;
+  state.SP = SP;
+  state.flag_N = FlagN();
+  state.flag_V = FlagV();
+  state.flag_D = FlagD();
+  state.flag_I = FlagI();
+  state.flag_Z = FlagZ();
+  state.flag_C = FlagC();
+  state.PC = PC;
+  return state;
+}
+
+void Cpu::LoadJitState(const JitState& state) {
+  A = state.A;
+  X = state.X;
+  Y = state.Y;
+  SP = state.SP;
+  SetNZ(state.flag_N, state.flag_Z);
+  SetFlag(FLAG_V, state.flag_V);
+  SetFlag(FLAG_D, state.flag_D);
+  SetFlag(FLAG_I, state.flag_I);
+  SetFlag(FLAG_C, state.flag_C);
+  PC = state.PC;
+}
+
+/*=================================================================
+*  Idle loops
+
+   A short loop in PRG-ROM that only reads internal RAM and comes back
+   round to its first instruction with every register as it was will do
+   the same thing again on the next iteration, and on every one after,
+   until an interrupt handler or DMA changes something. Once one iteration
+   has been recorded like that, further iterations are not decoded or
+   executed. As many whole iterations as fit before the PPU, APU or
+   scheduler could raise anything are charged to them in one go; the rest
+   are charged one instruction at a time, stopping wherever the
+   interpreter would have.
+
+   A loop polling PPUSTATUS is skipped the same way, as long as the PPU
+   can't change what the read returns. Its last iterations before that
+   are left to the interpreter, so that the read that sees VBlank (or
+   just misses it) happens on the same dot.
+=================================================================*/
+void Cpu::WatchIdleLoop(uint16_t target) {
+  if (target < 0x8000 || target == idle_rejected || Observed()) {
+    return;
+  }
+
+  idle_state = IdleState::Armed;
+  idle_start = target;
+  idle_rejected = 0;
+  idle_entry = SaveIdleStep();
+  idle_entry.PC = target;
+}
+
+// Called as each instruction starts while a loop is being recorded.
+void Cpu::TrackIdleLoop() {
+  if (idle_state == IdleState::Armed) {
+    idle_state = IdleState::Recording;
+    idle_length = 0;
+    idle_step_cycles = cycles;
+    idle_pure = true;
+    idle_status = false;
+    return;
+  }
+
+  IdleStep& step = idle_steps[idle_length++];
+  step = SaveIdleStep();
+  step.cycles = cycles - idle_step_cycles;
+  idle_step_cycles = cycles;
+
+  if (!idle_pure || (PC >= 0x2000 && PC < 0x8000)) {
+    idle_state = IdleState::Off;
+  } else if (PC == idle_start) {
+    if (SameRegisters(step, idle_entry)) {
+      idle_state = IdleState::Confirmed;
+      idle_loop_cycles = 0;
+
+      for (int i = 0; i < idle_length; i++) {
+        idle_loop_cycles += idle_steps[i].cycles;
+      }
+    } else {
+      idle_state = IdleState::Off;
+      idle_rejected = idle_start;
+    }
+  } else if (idle_length == IDLE_MAX_STEPS) {
+    idle_state = IdleState::Off;
+  }
+}
+
+void Cpu::SkipIdleLoop() {
+  idle_state = IdleState::Off;
+
+  // an interrupt or the JIT may have run since the loop was recorded
+  if (!idle_pure || !SameRegisters(SaveIdleStep(), idle_entry)) {
+    return;
+  }
+
+  if constexpr (PROFILE_ENABLED) {
+    profile.Begin(PROFILE_IDLE_SKIP, cycles);
   }
+
+  int i = 0;
+
+  do {
+    if (i == 0) {
+      uint64_t limit =
+          event_cycles < chain_limit ? chain_limit - event_cycles : 0;
+      uint64_t quiet = std::min(mmu.QuietCycles(idle_status), limit);
+      uint64_t iterations = quiet / idle_loop_cycles;
+
+      if (iterations > 0) {
+        uint64_t n = iterations * idle_loop_cycles;
+        cycles += n;
+        event_cycles += n;
+        mmu.PpuTick(3 * n);
+        mmu.ApuTick(n);
+        instructions += iterations * idle_length;
+        idle_cycles += n;
+        continue;
+      }
+
+      // the interpreter does the reads from here on
+      if (idle_status) {
+        return;
+      }
+    }
+
+    const IdleStep& step = idle_steps[i];
+
+    for (uint64_t n = 0; n < step.cycles; n++) {
+      AddCycle();
+    }
+
+    instructions++;
+    idle_cycles += step.cycles;
+    LoadIdleStep(step);
+    i = i + 1 == idle_length ? 0 : i + 1;
+  } while (CanChain());
+}
+
+IdleStep Cpu::SaveIdleStep() {
+  IdleStep step = {};
+  step.PC = PC;
+  step.A = A;
+  step.X = X;
+  step.Y = Y;
+  step.SP = SP;
+  step.P = P;
+  step.nz_result = nz_result;
+  return step;
+}
+
+void Cpu::LoadIdleStep(const IdleStep& step) {
+  PC = step.PC;
+  A = step.A;
+  X = step.X;
+  Y = step.Y;
+  SP = step.SP;
+  P = step.P;
+  nz_result = step.nz_result;
 }
 
 /*=================================================================
@@ -867,15 +565,11 @@ void Cpu::DecodeExecute(uint8_t opcode) {
 // /* 4 cycles */
 uint16_t Cpu::IndirectX() {
   uint8_t ptr_lo = Fetch();
-  uint8_t ptr_hi = 0x00;
-  ReadMemory((static_cast<uint16_t>(ptr_hi) << 8) |
-             static_cast<uint16_t>(ptr_lo));
+  ReadRam(ptr_lo);
   ptr_lo += X;
-  uint8_t lo = ReadMemory((static_cast<uint16_t>(ptr_hi) << 8) |
-                          static_cast<uint16_t>(ptr_lo));
+  uint8_t lo = ReadRam(ptr_lo);
   ptr_lo++;
-  uint8_t hi = ReadMemory((static_cast<uint16_t>(ptr_hi) << 8) |
-                          static_cast<uint16_t>(ptr_lo));
+  uint8_t hi = ReadRam(ptr_lo);
 
   return (static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo);
 }
@@ -883,16 +577,16 @@ uint16_t Cpu::IndirectX() {
 /* 3 or 4 cycles */
 uint16_t Cpu::IndirectY() {
   uint8_t ptr_lo = Fetch();
-  uint8_t ptr_hi = 0x00;
-  uint8_t lo = ReadMemory((static_cast<uint16_t>(ptr_hi) << 8) |
-                          static_cast<uint16_t>(ptr_lo));
+  uint8_t lo = ReadRam(ptr_lo);
   ptr_lo++;
-  uint8_t hi = ReadMemory((static_cast<uint16_t>(ptr_hi) << 8) |
-                          static_cast<uint16_t>(ptr_lo));
+  uint8_t hi = ReadRam(ptr_lo);
   bool inc = static_cast<uint16_t>(lo) + static_cast<uint16_t>(Y) > 0xFF;
   lo += Y;
   if (inc) {
-    ReadMemory((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
+    if constexpr (PROFILE_ENABLED) {
+      profile.page_crosses++;
+    }
+    DummyRead((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
     hi++;
   }
   return (static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo);
@@ -901,15 +595,12 @@ uint16_t Cpu::IndirectY() {
 /* 4 cycles */
 uint16_t Cpu::IndirectYW() {
   uint8_t ptr_lo = Fetch();
-  uint8_t ptr_hi = 0x00;
-  uint8_t lo = ReadMemory((static_cast<uint16_t>(ptr_hi) << 8) |
-                          static_cast<uint16_t>(ptr_lo));
+  uint8_t lo = ReadRam(ptr_lo);
   ptr_lo++;
-  uint8_t hi = ReadMemory((static_cast<uint16_t>(ptr_hi) << 8) |
-                          static_cast<uint16_t>(ptr_lo));
+  uint8_t hi = ReadRam(ptr_lo);
   bool inc = static_cast<uint16_t>(lo) + static_cast<uint16_t>(Y) > 0xFF;
   lo += Y;
-  ReadMemory((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
+  DummyRead((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
   if (inc) {
     hi++;
   }
@@ -919,14 +610,14 @@ uint16_t Cpu::IndirectYW() {
 /* 2 cycles */
 uint16_t Cpu::ZeroPageX() {
   uint16_t addr = static_cast<uint16_t>(Fetch());
-  ReadMemory(addr);
+  ReadRam(addr);
   return (addr + static_cast<uint16_t>(X)) & 0xFF;
 }
 
 /* 2 cycles */
 uint16_t Cpu::ZeroPageY() {
   uint16_t addr = static_cast<uint16_t>(Fetch());
-  ReadMemory(addr);
+  ReadRam(addr);
   return (addr + static_cast<uint16_t>(Y)) & 0xFF;
 }
 
@@ -947,7 +638,10 @@ uint16_t Cpu::AbsoluteX() {
   bool inc = static_cast<uint16_t>(lo) + static_cast<uint16_t>(X) > 0xFF;
   lo += X;
   if (inc) {
-    ReadMemory((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
+    if constexpr (PROFILE_ENABLED) {
+      profile.page_crosses++;
+    }
+    DummyRead((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
     hi++;
   }
   return (static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo);
@@ -960,7 +654,10 @@ uint16_t Cpu::AbsoluteY() {
   bool inc = static_cast<uint16_t>(lo) + static_cast<uint16_t>(Y) > 0xFF;
   lo += Y;
   if (inc) {
-    ReadMemory((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
+    if constexpr (PROFILE_ENABLED) {
+      profile.page_crosses++;
+    }
+    DummyRead((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
     hi++;
   }
   return (static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo);
@@ -972,7 +669,7 @@ uint16_t Cpu::AbsoluteXW() {
   uint8_t hi = Fetch();
   bool inc = static_cast<uint16_t>(lo) + static_cast<uint16_t>(X) > 0xFF;
   lo += X;
-  ReadMemory((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
+  DummyRead((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
   if (inc) {
     hi++;
   }
@@ -985,45 +682,91 @@ uint16_t Cpu::AbsoluteYW() {
   uint8_t hi = Fetch();
   bool inc = static_cast<uint16_t>(lo) + static_cast<uint16_t>(Y) > 0xFF;
   lo += Y;
-  ReadMemory((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
+  DummyRead((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
   if (inc) {
     hi++;
   }
   return (static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo);
 }
 
-/******************************************************************
-  LDA
-******************************************************************/
-void Cpu::LdaImmediate() {
-  A = Fetch();
-  UpdateNZ(A);
+/*=================================================================
+*  Instruction templates
+
+   Most instructions are an operation composed with an addressing mode.
+   Both are passed as compile-time constants so every opcode gets its own
+   fully inlined handler.
+=================================================================*/
+template <uint16_t (Cpu::*Mode)()>
+constexpr bool Cpu::ZeroPageMode() {
+  return Mode == &Cpu::ZeroPage || Mode == &Cpu::ZeroPageX ||
+         Mode == &Cpu::ZeroPageY;
 }
 
-void Cpu::LdaZeroPage() {
-  uint16_t addr = ZeroPage();
-  A = ReadMemory(addr);
-  UpdateNZ(A);
+template <uint16_t (Cpu::*Mode)()>
+uint8_t Cpu::ReadOperand(uint16_t addr) {
+  if constexpr (ZeroPageMode<Mode>()) {
+    return ReadRam(addr);
+  } else {
+    return ReadMemory(addr);
+  }
 }
 
-void Cpu::LdaZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  A = ReadMemory(addr);
-  UpdateNZ(A);
+template <uint16_t (Cpu::*Mode)()>
+void Cpu::WriteOperand(uint16_t addr, uint8_t value) {
+  if constexpr (ZeroPageMode<Mode>()) {
+    WriteRam(addr, value);
+  } else {
+    WriteMemory(addr, value);
+  }
 }
 
-void Cpu::LdaAbsolute() {
-  uint16_t addr = Absolute();
-  A = ReadMemory(addr);
-  UpdateNZ(A);
+template <void (Cpu::*Op)(uint8_t)>
+void Cpu::Immediate() {
+  (this->*Op)(Fetch());
 }
 
-void Cpu::LdaAbsoluteX() {
-  uint16_t addr = AbsoluteX();
-  A = ReadMemory(addr);
+template <void (Cpu::*Op)(uint8_t), uint16_t (Cpu::*Mode)()>
+void Cpu::Read() {
+  uint16_t addr = (this->*Mode)();
+  (this->*Op)(ReadOperand<Mode>(addr));
+}
+
+template <uint8_t (Cpu::*Op)(uint16_t), uint16_t (Cpu::*Mode)()>
+void Cpu::Write() {
+  uint16_t addr = (this->*Mode)();
+  WriteOperand<Mode>(addr, (this->*Op)(addr));
+}
+
+/* read, dummy write of the old value, write of the new value */
+template <uint8_t (Cpu::*Op)(uint8_t), uint16_t (Cpu::*Mode)()>
+void Cpu::Modify() {
+  uint16_t addr = (this->*Mode)();
+  uint8_t value = ReadOperand<Mode>(addr);
+  WriteOperand<Mode>(addr, value);
+  WriteOperand<Mode>(addr, (this->*Op)(value));
+}
+
+template <uint8_t (Cpu::*Op)(uint8_t)>
+void Cpu::Accumulator() {
+  A = (this->*Op)(A);
+  AddCycle();
+}
+
+/* unofficial NOPs only spend the cycles of their addressing mode */
+template <uint16_t (Cpu::*Mode)()>
+void Cpu::Nop() {
+  (this->*Mode)();
+}
+
+/******************************************************************
+  LDA
+******************************************************************/
+void Cpu::Lda(uint8_t value) {
+  A = value;
   UpdateNZ(A);
 }
 
+// Spends one more cycle than Read<&Cpu::Lda, &Cpu::AbsoluteY>.
 void Cpu::LdaAbsoluteY() {
   uint16_t addr = AbsoluteY();
   if (addr > 0xFF) {
@@ -1033,133 +776,36 @@ void Cpu::LdaAbsoluteY() {
   UpdateNZ(A);
 }
 
-void Cpu::LdaIndirectX() {
-  uint16_t addr = IndirectX();
-  A = ReadMemory(addr);
-  UpdateNZ(A);
-}
-
-void Cpu::LdaIndirectY() {
-  uint16_t addr = IndirectY();
-  A = ReadMemory(addr);
-  UpdateNZ(A);
-}
-
 /******************************************************************
   LDX
 ******************************************************************/
-void Cpu::LdxImmediate() {
-  X = Fetch();
-  UpdateNZ(X);
-}
-
-void Cpu::LdxZeroPage() { Ldx(ZeroPage()); }
-
-void Cpu::LdxZeroPageY() { Ldx(ZeroPageY()); }
-
-void Cpu::LdxAbsolute() { Ldx(Absolute()); }
-
-void Cpu::LdxAbsoluteY() { Ldx(AbsoluteY()); }
-
-void Cpu::Ldx(uint16_t addr) {
-  X = ReadMemory(addr);
+void Cpu::Ldx(uint8_t value) {
+  X = value;
   UpdateNZ(X);
 }
 
 /******************************************************************
   LDY
 ******************************************************************/
-void Cpu::LdyImmediate() {
-  Y = Fetch();
-  UpdateNZ(Y);
-}
-
-void Cpu::LdyZeroPage() { Ldy(ZeroPage()); }
-
-void Cpu::LdyZeroPageX() { Ldy(ZeroPageX()); }
-
-void Cpu::LdyAbsolute() { Ldy(Absolute()); }
-
-void Cpu::LdyAbsoluteX() { Ldy(AbsoluteX()); }
-
-void Cpu::Ldy(uint16_t addr) {
-  Y = ReadMemory(addr);
+void Cpu::Ldy(uint8_t value) {
+  Y = value;
   UpdateNZ(Y);
 }
 
 /******************************************************************
   STA
 ******************************************************************/
-void Cpu::StaZeroPage() {
-  uint16_t addr = ZeroPage();
-  WriteMemory(addr, A);
-}
-
-void Cpu::StaZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  WriteMemory(addr, A);
-}
-
-void Cpu::StaAbsolute() {
-  uint16_t addr = Absolute();
-  WriteMemory(addr, A);
-}
-
-void Cpu::StaAbsoluteX() {
-  uint16_t addr = AbsoluteXW();
-  WriteMemory(addr, A);
-}
-
-void Cpu::StaAbsoluteY() {
-  uint16_t addr = AbsoluteYW();
-  WriteMemory(addr, A);
-}
-
-void Cpu::StaIndirectX() {
-  uint16_t addr = IndirectX();
-  WriteMemory(addr, A);
-}
-
-void Cpu::StaIndirectY() {
-  uint16_t addr = IndirectYW();
-  WriteMemory(addr, A);
-}
+uint8_t Cpu::Sta(uint16_t /*addr*/) { return A; }
 
 /******************************************************************
   STX
 ******************************************************************/
-void Cpu::StxZeroPage() {
-  uint16_t addr = ZeroPage();
-  WriteMemory(addr, X);
-}
-
-void Cpu::StxZeroPageY() {
-  uint16_t addr = ZeroPageY();
-  WriteMemory(addr, X);
-}
-
-void Cpu::StxAbsolute() {
-  uint16_t addr = Absolute();
-  WriteMemory(addr, X);
-}
+uint8_t Cpu::Stx(uint16_t /*addr*/) { return X; }
 
 /******************************************************************
   STY
 ******************************************************************/
-void Cpu::StyZeroPage() {
-  uint16_t addr = ZeroPage();
-  WriteMemory(addr, Y);
-}
-
-void Cpu::StyZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  WriteMemory(addr, Y);
-}
-
-void Cpu::StyAbsolute() {
-  uint16_t addr = Absolute();
-  WriteMemory(addr, Y);
-}
+uint8_t Cpu::Sty(uint16_t /*addr*/) { return Y; }
 
 /******************************************************************
   TAX
@@ -1227,12 +873,7 @@ void Cpu::PhaImplied() {
 ******************************************************************/
 void Cpu::PhpImplied() {
   AddCycle();
-  Push((static_cast<uint8_t>(flag_N) << 7) |
-       (static_cast<uint8_t>(flag_V) << 6) | (1 << 5) | (1 << 4) |
-       (static_cast<uint8_t>(flag_D) << 3) |
-       (static_cast<uint8_t>(flag_I) << 2) |
-       (static_cast<uint8_t>(flag_Z) << 1) |
-       (static_cast<uint8_t>(flag_C) << 0));
+  Push(Status() | FLAG_U | FLAG_B);
 }
 
 /******************************************************************
@@ -1253,43 +894,16 @@ void Cpu::PlpImplied() {
   AddCycle();
   SP++;
   AddCycle();
-  uint8_t status = Pull(SP);
-  flag_N = static_cast<bool>((status >> 7) & 0x1);
-  flag_V = static_cast<bool>((status >> 6) & 0x1);
-  flag_D = static_cast<bool>((status >> 3) & 0x1);
-  flag_I = static_cast<bool>((status >> 2) & 0x1);
-  flag_Z = static_cast<bool>((status >> 1) & 0x1);
-  flag_C = static_cast<bool>((status >> 0) & 0x1);
+  SetStatus(Pull(SP));
 }
 
 /******************************************************************
   DEC
 ******************************************************************/
-void Cpu::DecZeroPage() {
-  uint16_t addr = ZeroPage();
-  Dec(addr, ReadMemory(addr));
-}
-
-void Cpu::DecZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  Dec(addr, ReadMemory(addr));
-}
-
-void Cpu::DecAbsolute() {
-  uint16_t addr = Absolute();
-  Dec(addr, ReadMemory(addr));
-}
-
-void Cpu::DecAbsoluteX() {
-  uint16_t addr = AbsoluteXW();
-  Dec(addr, ReadMemory(addr));
-}
-
-void Cpu::Dec(uint16_t addr, uint8_t value) {
-  WriteMemory(addr, value);
+uint8_t Cpu::Dec(uint8_t value) {
   value--;
-  WriteMemory(addr, value);
   UpdateNZ(value);
+  return value;
 }
 
 /******************************************************************
@@ -1313,32 +927,10 @@ void Cpu::DeyImplied() {
 /******************************************************************
   INC
 ******************************************************************/
-
-void Cpu::IncZeroPage() {
-  uint16_t addr = ZeroPage();
-  Inc(addr, ReadMemory(addr));
-}
-
-void Cpu::IncZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  Inc(addr, ReadMemory(addr));
-}
-
-void Cpu::IncAbsolute() {
-  uint16_t addr = Absolute();
-  Inc(addr, ReadMemory(addr));
-}
-
-void Cpu::IncAbsoluteX() {
-  uint16_t addr = AbsoluteXW();
-  Inc(addr, ReadMemory(addr));
-}
-
-void Cpu::Inc(uint16_t addr, uint8_t value) {
-  WriteMemory(addr, value);
+uint8_t Cpu::Inc(uint8_t value) {
   value++;
-  WriteMemory(addr, value);
   UpdateNZ(value);
+  return value;
 }
 
 /******************************************************************
@@ -1362,43 +954,6 @@ void Cpu::InyImplied() {
 /******************************************************************
   ADC
 ******************************************************************/
-void Cpu::AdcImmediate() { Adc(Fetch()); }
-
-void Cpu::AdcZeroPage() {
-  uint16_t addr = ZeroPage();
-  Adc(ReadMemory(addr));
-}
-
-void Cpu::AdcZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  Adc(ReadMemory(addr));
-}
-
-void Cpu::AdcAbsolute() {
-  uint16_t addr = Absolute();
-  Adc(ReadMemory(addr));
-}
-
-void Cpu::AdcAbsoluteX() {
-  uint16_t addr = AbsoluteX();
-  Adc(ReadMemory(addr));
-}
-
-void Cpu::AdcAbsoluteY() {
-  uint16_t addr = AbsoluteY();
-  Adc(ReadMemory(addr));
-}
-
-void Cpu::AdcIndirectX() {
-  uint16_t addr = IndirectX();
-  Adc(ReadMemory(addr));
-}
-
-void Cpu::AdcIndirectY() {
-  uint16_t addr = IndirectY();
-  Adc(ReadMemory(addr));
-}
-
 bool Cpu::Overflow(int8_t reg, int8_t value, int8_t carry) {
   int16_t result = static_cast<int16_t>(reg) + static_cast<int16_t>(value) +
                    static_cast<int16_t>(carry);
@@ -1407,97 +962,22 @@ bool Cpu::Overflow(int8_t reg, int8_t value, int8_t carry) {
 
 void Cpu::Adc(uint8_t value) {
   uint16_t result = static_cast<uint16_t>(A) + static_cast<uint16_t>(value) +
-                    static_cast<uint16_t>(flag_C);
-  flag_V = Overflow(static_cast<int8_t>(A), static_cast<int8_t>(value),
-                    static_cast<int8_t>(flag_C));
-  flag_C = result > 0xFF;
+                    static_cast<uint16_t>(P & FLAG_C);
+  SetFlag(FLAG_V, Overflow(static_cast<int8_t>(A), static_cast<int8_t>(value),
+                           static_cast<int8_t>(P & FLAG_C)));
+  SetFlag(FLAG_C, result > 0xFF);
   A = static_cast<uint8_t>(result & 0xFF);
-  flag_Z = A == 0;
-  flag_N = static_cast<bool>(A & 0x80);
-}
-
-/******************************************************************
-  SBC
-******************************************************************/
-void Cpu::SbcImmediate() { Sbc(Fetch()); }
-
-void Cpu::SbcZeroPage() {
-  uint16_t addr = ZeroPage();
-  Sbc(ReadMemory(addr));
-}
-
-void Cpu::SbcZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  Sbc(ReadMemory(addr));
-}
-
-void Cpu::SbcAbsolute() {
-  uint16_t addr = Absolute();
-  Sbc(ReadMemory(addr));
-}
-
-void Cpu::SbcAbsoluteX() {
-  uint16_t addr = AbsoluteX();
-  Sbc(ReadMemory(addr));
-}
-
-void Cpu::SbcAbsoluteY() {
-  uint16_t addr = AbsoluteY();
-  Sbc(ReadMemory(addr));
-}
-
-void Cpu::SbcIndirectX() {
-  uint16_t addr = IndirectX();
-  Sbc(ReadMemory(addr));
-}
-
-void Cpu::SbcIndirectY() {
-  uint16_t addr = IndirectY();
-  Sbc(ReadMemory(addr));
+  UpdateNZ(A);
 }
 
-void Cpu::Sbc(uint8_t value) { Cpu::Adc(value ^ 0xFF); }
-
 /******************************************************************
-  AND
-******************************************************************/
-void Cpu::AndImmediate() { And(Fetch()); }
-
-void Cpu::AndZeroPage() {
-  uint16_t addr = ZeroPage();
-  And(ReadMemory(addr));
-}
-
-void Cpu::AndZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  And(ReadMemory(addr));
-}
-
-void Cpu::AndAbsolute() {
-  uint16_t addr = Absolute();
-  And(ReadMemory(addr));
-}
-
-void Cpu::AndAbsoluteX() {
-  uint16_t addr = AbsoluteX();
-  And(ReadMemory(addr));
-}
-
-void Cpu::AndAbsoluteY() {
-  uint16_t addr = AbsoluteY();
-  And(ReadMemory(addr));
-}
-
-void Cpu::AndIndirectX() {
-  uint16_t addr = IndirectX();
-  And(ReadMemory(addr));
-}
-
-void Cpu::AndIndirectY() {
-  uint16_t addr = IndirectY();
-  And(ReadMemory(addr));
-}
+  SBC
+******************************************************************/
+void Cpu::Sbc(uint8_t value) { Cpu::Adc(value ^ 0xFF); }
 
+/******************************************************************
+  AND
+******************************************************************/
 void Cpu::And(uint8_t value) {
   A &= value;
   UpdateNZ(A);
@@ -1506,43 +986,6 @@ void Cpu::And(uint8_t value) {
 /******************************************************************
   EOR
 ******************************************************************/
-void Cpu::EorImmediate() { Eor(Fetch()); }
-
-void Cpu::EorZeroPage() {
-  uint16_t addr = ZeroPage();
-  Eor(ReadMemory(addr));
-}
-
-void Cpu::EorZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  Eor(ReadMemory(addr));
-}
-
-void Cpu::EorAbsolute() {
-  uint16_t addr = Absolute();
-  Eor(ReadMemory(addr));
-}
-
-void Cpu::EorAbsoluteX() {
-  uint16_t addr = AbsoluteX();
-  Eor(ReadMemory(addr));
-}
-
-void Cpu::EorAbsoluteY() {
-  uint16_t addr = AbsoluteY();
-  Eor(ReadMemory(addr));
-}
-
-void Cpu::EorIndirectX() {
-  uint16_t addr = IndirectX();
-  Eor(ReadMemory(addr));
-}
-
-void Cpu::EorIndirectY() {
-  uint16_t addr = IndirectY();
-  Eor(ReadMemory(addr));
-}
-
 void Cpu::Eor(uint8_t value) {
   A ^= value;
   UpdateNZ(A);
@@ -1551,43 +994,6 @@ void Cpu::Eor(uint8_t value) {
 /******************************************************************
   ORA
 ******************************************************************/
-void Cpu::OraImmediate() { Ora(Fetch()); }
-
-void Cpu::OraZeroPage() {
-  uint16_t addr = ZeroPage();
-  Ora(ReadMemory(addr));
-}
-
-void Cpu::OraZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  Ora(ReadMemory(addr));
-}
-
-void Cpu::OraAbsolute() {
-  uint16_t addr = Absolute();
-  Ora(ReadMemory(addr));
-}
-
-void Cpu::OraAbsoluteX() {
-  uint16_t addr = AbsoluteX();
-  Ora(ReadMemory(addr));
-}
-
-void Cpu::OraAbsoluteY() {
-  uint16_t addr = AbsoluteY();
-  Ora(ReadMemory(addr));
-}
-
-void Cpu::OraIndirectX() {
-  uint16_t addr = IndirectX();
-  Ora(ReadMemory(addr));
-}
-
-void Cpu::OraIndirectY() {
-  uint16_t addr = IndirectY();
-  Ora(ReadMemory(addr));
-}
-
 void Cpu::Ora(uint8_t value) {
   A |= value;
   UpdateNZ(A);
@@ -1596,285 +1002,121 @@ void Cpu::Ora(uint8_t value) {
 /******************************************************************
   ASL
 ******************************************************************/
-void Cpu::AslAccumulator() {
-  flag_C = static_cast<bool>(A >> 7);
-  A = (A << 1) & 0xFE;
-  AddCycle();
-  UpdateNZ(A);
-}
-
-void Cpu::AslZeroPage() {
-  uint16_t addr = ZeroPage();
-  Asl(addr, ReadMemory(addr));
-}
-
-void Cpu::AslZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  Asl(addr, ReadMemory(addr));
-}
-
-void Cpu::AslAbsolute() {
-  uint16_t addr = Absolute();
-  Asl(addr, ReadMemory(addr));
-}
-
-void Cpu::AslAbsoluteX() {
-  uint16_t addr = AbsoluteXW();
-  Asl(addr, ReadMemory(addr));
-}
-
-void Cpu::Asl(uint16_t addr, uint8_t value) {
-  WriteMemory(addr, value);
-  flag_C = static_cast<bool>(value >> 7);
+uint8_t Cpu::Asl(uint8_t value) {
+  SetFlag(FLAG_C, static_cast<bool>(value >> 7));
   value = (value << 1) & 0xFE;
-  WriteMemory(addr, value);
   UpdateNZ(value);
+  return value;
 }
 
 /******************************************************************
   LSR
 ******************************************************************/
-void Cpu::LsrAccumulator() {
-  flag_C = static_cast<bool>(A & 0x1);
-  A = (A >> 1) & 0x7F;
-  AddCycle();
-  UpdateNZ(A);
-}
-
-void Cpu::LsrZeroPage() {
-  uint16_t addr = ZeroPage();
-  Lsr(addr, ReadMemory(addr));
-}
-
-void Cpu::LsrZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  Lsr(addr, ReadMemory(addr));
-}
-
-void Cpu::LsrAbsolute() {
-  uint16_t addr = Absolute();
-  Lsr(addr, ReadMemory(addr));
-}
-
-void Cpu::LsrAbsoluteX() {
-  uint16_t addr = AbsoluteXW();
-  Lsr(addr, ReadMemory(addr));
-}
-
-void Cpu::Lsr(uint16_t addr, uint8_t value) {
-  WriteMemory(addr, value);
-  flag_C = static_cast<bool>(value & 0x1);
+uint8_t Cpu::Lsr(uint8_t value) {
+  SetFlag(FLAG_C, static_cast<bool>(value & 0x1));
   value = (value >> 1) & 0x7F;
-  WriteMemory(addr, value);
   UpdateNZ(value);
+  return value;
 }
 
 /******************************************************************
   ROL
 ******************************************************************/
-void Cpu::RolAccumulator() {
-  uint8_t old_C = static_cast<uint8_t>(flag_C);
-  flag_C = static_cast<bool>(A >> 7);
-  A = ((A << 1) & 0xFE) | old_C;
-  AddCycle();
-  UpdateNZ(A);
-}
-
-void Cpu::RolZeroPage() {
-  uint16_t addr = ZeroPage();
-  Rol(addr, ReadMemory(addr));
-}
-
-void Cpu::RolZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  Rol(addr, ReadMemory(addr));
-}
-
-void Cpu::RolAbsolute() {
-  uint16_t addr = Absolute();
-  Rol(addr, ReadMemory(addr));
-}
-
-void Cpu::RolAbsoluteX() {
-  uint16_t addr = AbsoluteXW();
-  Rol(addr, ReadMemory(addr));
-}
-
-void Cpu::Rol(uint16_t addr, uint8_t value) {
-  WriteMemory(addr, value);
-  uint8_t old_C = static_cast<uint8_t>(flag_C);
-  flag_C = static_cast<bool>(value >> 7);
+uint8_t Cpu::Rol(uint8_t value) {
+  uint8_t old_C = P & FLAG_C;
+  SetFlag(FLAG_C, static_cast<bool>(value >> 7));
   value = ((value << 1) & 0xFE) | old_C;
-  WriteMemory(addr, value);
   UpdateNZ(value);
+  return value;
 }
 
 /******************************************************************
   ROR
 ******************************************************************/
-void Cpu::RorAccumulator() {
-  uint8_t old_C = static_cast<uint8_t>(flag_C);
-  flag_C = static_cast<bool>(A & 0x1);
-  A = ((A >> 1) & 0x7F) | (old_C << 7);
-  AddCycle();
-  UpdateNZ(A);
-}
-
-void Cpu::RorZeroPage() {
-  uint16_t addr = ZeroPage();
-  Ror(addr, ReadMemory(addr));
-}
-
-void Cpu::RorZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  Ror(addr, ReadMemory(addr));
-}
-
-void Cpu::RorAbsolute() {
-  uint16_t addr = Absolute();
-  Ror(addr, ReadMemory(addr));
-}
-
-void Cpu::RorAbsoluteX() {
-  uint16_t addr = AbsoluteXW();
-  Ror(addr, ReadMemory(addr));
-}
-
-void Cpu::Ror(uint16_t addr, uint8_t value) {
-  WriteMemory(addr, value);
-  uint8_t old_C = static_cast<uint8_t>(flag_C);
-  flag_C = static_cast<bool>(value & 0x1);
+uint8_t Cpu::Ror(uint8_t value) {
+  uint8_t old_C = P & FLAG_C;
+  SetFlag(FLAG_C, static_cast<bool>(value & 0x1));
   value = ((value >> 1) & 0x7F) | (old_C << 7);
-  WriteMemory(addr, value);
   UpdateNZ(value);
+  return value;
 }
 
 /*================================================================
   Comparisons
 ================================================================*/
 
-void Cpu::Cmp(uint8_t reg, uint8_t value) {
-  flag_C = reg >= value;
-  uint8_t result = reg - value;
-  flag_N = static_cast<bool>(result & 0x80);
-  flag_Z = result == 0;
+void Cpu::Compare(uint8_t reg, uint8_t value) {
+  SetFlag(FLAG_C, reg >= value);
+  UpdateNZ(reg - value);
 }
 
 /******************************************************************
   CMP
 ******************************************************************/
-void Cpu::CmpImmediate() { Cmp(A, Fetch()); }
-
-void Cpu::CmpZeroPage() {
-  uint16_t addr = ZeroPage();
-  Cmp(A, ReadMemory(addr));
-}
-
-void Cpu::CmpZeroPageX() {
-  uint16_t addr = ZeroPageX();
-  Cmp(A, ReadMemory(addr));
-}
-
-void Cpu::CmpAbsolute() {
-  uint16_t addr = Absolute();
-  Cmp(A, ReadMemory(addr));
-}
-
-void Cpu::CmpAbsoluteX() {
-  uint16_t addr = AbsoluteX();
-  Cmp(A, ReadMemory(addr));
-}
-
-void Cpu::CmpAbsoluteY() {
-  uint16_t addr = AbsoluteY();
-  Cmp(A, ReadMemory(addr));
-}
-
-void Cpu::CmpIndirectX() {
-  uint16_t addr = IndirectX();
-  Cmp(A, ReadMemory(addr));
-}
-
-void Cpu::CmpIndirectY() {
-  uint16_t addr = IndirectY();
-  Cmp(A, ReadMemory(addr));
-}
+void Cpu::Cmp(uint8_t value) { Compare(A, value); }
 
 /******************************************************************
   CPX
 ******************************************************************/
-void Cpu::CpxImmediate() { Cmp(X, Fetch()); }
-
-void Cpu::CpxZeroPage() {
-  uint16_t addr = ZeroPage();
-  Cmp(X, ReadMemory(addr));
-}
-
-void Cpu::CpxAbsolute() {
-  uint16_t addr = Absolute();
-  Cmp(X, ReadMemory(addr));
-}
+void Cpu::Cpx(uint8_t value) { Compare(X, value); }
 
 /******************************************************************
   CPY
 ******************************************************************/
-void Cpu::CpyImmediate() { Cmp(Y, Fetch()); }
-
-void Cpu::CpyZeroPage() {
-  uint16_t addr = ZeroPage();
-  Cmp(Y, ReadMemory(addr));
-}
-
-void Cpu::CpyAbsolute() {
-  uint16_t addr = Absolute();
-  Cmp(Y, ReadMemory(addr));
-}
+void Cpu::Cpy(uint8_t value) { Compare(Y, value); }
 
 /******************************************************************
   Flag Instructions
 ******************************************************************/
-void Cpu::ClcImplied() { UpdateFlag(flag_C, false); }
+void Cpu::ClcImplied() { UpdateFlag(FLAG_C, false); }
 
-void Cpu::CldImplied() { UpdateFlag(flag_D, false); }
+void Cpu::CldImplied() { UpdateFlag(FLAG_D, false); }
 
-void Cpu::CliImplied() { UpdateFlag(flag_I, false); }
+void Cpu::CliImplied() { UpdateFlag(FLAG_I, false); }
 
-void Cpu::ClvImplied() { UpdateFlag(flag_V, false); }
+void Cpu::ClvImplied() { UpdateFlag(FLAG_V, false); }
 
-void Cpu::SecImplied() { UpdateFlag(flag_C, true); }
+void Cpu::SecImplied() { UpdateFlag(FLAG_C, true); }
 
-void Cpu::SedImplied() { UpdateFlag(flag_D, true); }
+void Cpu::SedImplied() { UpdateFlag(FLAG_D, true); }
 
-void Cpu::SeiImplied() { UpdateFlag(flag_I, true); }
+void Cpu::SeiImplied() { UpdateFlag(FLAG_I, true); }
 
-void Cpu::UpdateFlag(bool& flag, bool value) {
-  flag = value;
+void Cpu::UpdateFlag(uint8_t flag, bool value) {
+  SetFlag(flag, value);
   AddCycle();
 }
 
 /*****************************************************************
    Conditional Branch Instructions
  *****************************************************************/
-void Cpu::BccRelative() { Branch(!flag_C); }
+void Cpu::BccRelative() { Branch(!FlagC()); }
 
-void Cpu::BcsRelative() { Branch(flag_C); }
+void Cpu::BcsRelative() { Branch(FlagC()); }
 
-void Cpu::BeqRelative() { Branch(flag_Z); }
+void Cpu::BeqRelative() { Branch(FlagZ()); }
 
-void Cpu::BmiRelative() { Branch(flag_N); }
+void Cpu::BmiRelative() { Branch(FlagN()); }
 
-void Cpu::BneRelative() { Branch(!flag_Z); }
+void Cpu::BneRelative() { Branch(!FlagZ()); }
 
-void Cpu::BplRelative() { Branch(!flag_N); }
+void Cpu::BplRelative() { Branch(!FlagN()); }
 
-void Cpu::BvcRelative() { Branch(!flag_V); }
+void Cpu::BvcRelative() { Branch(!FlagV()); }
 
-void Cpu::BvsRelative() { Branch(flag_V); }
+void Cpu::BvsRelative() { Branch(FlagV()); }
 
 void Cpu::Branch(bool condition) {
   int16_t offset = static_cast<int16_t>(static_cast<int8_t>(Fetch()));
   if (condition) {
     PC = static_cast<uint16_t>(static_cast<int16_t>(PC) + offset);
+
+    // a loop confirmed on its last iteration never comes round again
+    if (offset < 0 && (idle_state == IdleState::Off ||
+                       (idle_state == IdleState::Confirmed &&
+                        PC != idle_start))) {
+      WatchIdleLoop(PC);
+    }
   }
 }
 
@@ -1918,16 +1160,8 @@ void Cpu::BrkImplied() {
   Fetch();
   Push(static_cast<uint8_t>(PC >> 8));
   Push(static_cast<uint8_t>(PC));
-  uint8_t SR = (static_cast<uint8_t>(flag_N) << 7) |
-               (static_cast<uint8_t>(flag_V) << 6) |
-               (/*                      */ 1 << 5) |
-               (/*                      */ 1 << 4) |
-               (static_cast<uint8_t>(flag_D) << 3) |
-               (static_cast<uint8_t>(flag_I) << 2) |
-               (static_cast<uint8_t>(flag_Z) << 1) |
-               (static_cast<uint8_t>(flag_C) << 0);
-  Push(SR);
-  flag_I = true;
+  Push(Status() | FLAG_U | FLAG_B);
+  SetFlag(FLAG_I, true);
   PC = static_cast<uint16_t>(ReadMemory(0xFFFE));
   PC |= static_cast<uint16_t>(ReadMemory(0xFFFF)) << 8;
 }
@@ -1936,31 +1170,24 @@ void Cpu::RtiImplied() {
   AddCycle();
   SP++;
   AddCycle();
-  uint8_t status = Pull(SP++);
-  flag_N = static_cast<bool>((status >> 7) & 0x1);
-  flag_V = static_cast<bool>((status >> 6) & 0x1);
-  flag_D = static_cast<bool>((status >> 3) & 0x1);
-  flag_I = static_cast<bool>((status >> 2) & 0x1);
-  flag_Z = static_cast<bool>((status >> 1) & 0x1);
-  flag_C = static_cast<bool>((status >> 0) & 0x1);
+  SetStatus(Pull(SP++));
 
   PC = static_cast<uint16_t>(Pull(SP++)) & 0xFF;
   PC |= static_cast<uint16_t>(Pull(SP)) << 8;
 }
 
 void Cpu::Interrupt(InterruptType type) {
+  if constexpr (PROFILE_ENABLED) {
+    profile.Begin(type == InterruptType::Nmi ? PROFILE_NMI : PROFILE_IRQ,
+                  cycles);
+  }
+
   AddCycle();
   AddCycle();
   Push(static_cast<uint8_t>((PC >> 8) & 0xFF));
   Push(static_cast<uint8_t>(PC & 0xFF));
-  uint8_t SR = (static_cast<uint8_t>(flag_N) << 7) |
-               (static_cast<uint8_t>(flag_V) << 6) | (0 << 4) |
-               (static_cast<uint8_t>(flag_D) << 3) |
-               (static_cast<uint8_t>(flag_I) << 2) |
-               (static_cast<uint8_t>(flag_Z) << 1) |
-               (static_cast<uint8_t>(flag_C) << 0);
-  Push(SR);
-  flag_I = true;
+  Push(Status());
+  SetFlag(FLAG_I, true);
   uint16_t addr_lo = type == InterruptType::Irq ? 0xFFFE : 0xFFFA;
   uint16_t addr_hi = type == InterruptType::Irq ? 0xFFFF : 0xFFFB;
   PC = static_cast<uint16_t>(ReadMemory(addr_lo));
@@ -1970,204 +1197,105 @@ void Cpu::Interrupt(InterruptType type) {
 /*****************************************************************
    BIT
  *****************************************************************/
-void Cpu::BitZeroPage() { Bit(static_cast<uint16_t>(Fetch())); }
-
-void Cpu::BitAbsolute() {
-  uint16_t addr = Absolute();
-  Bit(addr);
-}
-
-void Cpu::Bit(uint16_t addr) {
-  uint8_t value = ReadMemory(addr);
-  flag_Z = (A & value) == 0;
-  flag_N = static_cast<bool>(value & 0x80);
-  flag_V = static_cast<bool>(value & 0x40);
+void Cpu::Bit(uint8_t value) {
+  SetNZ(static_cast<bool>(value & 0x80), (A & value) == 0);
+  SetFlag(FLAG_V, static_cast<bool>(value & 0x40));
 }
 
 /*****************************************************************
    Illegal Opcodes
  *****************************************************************/
-void Cpu::AlrImmediate() {
-  A &= Fetch();
-  flag_C = static_cast<bool>(A & 0x1);
+void Cpu::Alr(uint8_t value) {
+  A &= value;
+  SetFlag(FLAG_C, static_cast<bool>(A & 0x1));
   A = A >> 1;
   UpdateNZ(A);
 }
 
-void Cpu::AncImmediate() {
-  A &= Fetch();
-  flag_C = static_cast<bool>((A >> 7) & 0x1);
+void Cpu::Anc(uint8_t value) {
+  A &= value;
+  SetFlag(FLAG_C, static_cast<bool>((A >> 7) & 0x1));
   UpdateNZ(A);
 }
 
-void Cpu::AneImmediate() {
-  A = (A | 0x00) & X & Fetch();
+void Cpu::Ane(uint8_t value) {
+  A = (A | 0x00) & X & value;
   UpdateNZ(A);
 }
 
-void Cpu::ArrImmediate() {
-  A = ((static_cast<uint8_t>(flag_C) << 7) | (A & Fetch()) >> 1);
-  flag_C = static_cast<bool>((A >> 6) & 0x1);
-  flag_V = static_cast<bool>(static_cast<uint8_t>(flag_C) ^ ((A >> 5) & 0x1));
+void Cpu::Arr(uint8_t value) {
+  A = (((P & FLAG_C) << 7) | (A & value) >> 1);
+  SetFlag(FLAG_C, static_cast<bool>((A >> 6) & 0x1));
+  SetFlag(FLAG_V, static_cast<bool>((P & FLAG_C) ^ ((A >> 5) & 0x1)));
   UpdateNZ(A);
 }
 
-void Cpu::DcpZeroPage() { Dcp(ZeroPage()); }
-
-void Cpu::DcpZeroPageX() { Dcp(ZeroPageX()); }
-
-void Cpu::DcpAbsolute() { Dcp(Absolute()); }
-
-void Cpu::DcpAbsoluteX() { Dcp(AbsoluteXW()); }
-
-void Cpu::DcpAbsoluteY() { Dcp(AbsoluteYW()); }
-
-void Cpu::DcpIndirectX() { Dcp(IndirectX()); }
-
-void Cpu::DcpIndirectY() { Dcp(IndirectYW()); }
-
-void Cpu::Dcp(uint16_t addr) {
-  uint8_t value = ReadMemory(addr);
-  WriteMemory(addr, value);
-  Cmp(A, value - 1);
-  WriteMemory(addr, value - 1);
+uint8_t Cpu::Dcp(uint8_t value) {
+  Compare(A, value - 1);
+  return value - 1;
 }
 
-void Cpu::IscZeroPage() { Isc(ZeroPage()); }
-
-void Cpu::IscZeroPageX() { Isc(ZeroPageX()); }
-
-void Cpu::IscAbsolute() { Isc(Absolute()); }
-
-void Cpu::IscAbsoluteX() { Isc(AbsoluteX()); }
-
-void Cpu::IscAbsoluteY() { Isc(AbsoluteY()); }
-
-void Cpu::IscIndirectX() { Isc(IndirectX()); }
-
-void Cpu::IscIndirectY() { Isc(IndirectYW()); }
-
-void Cpu::Isc(uint16_t addr) {
-  uint8_t value = ReadMemory(addr);
-  WriteMemory(addr, value);
+uint8_t Cpu::Isc(uint8_t value) {
   Sbc(value + 1);
-  WriteMemory(addr, value + 1);
+  return value + 1;
 }
 
-void Cpu::LasAbsoluteY() {
-  uint8_t value = SP & ReadMemory(AbsoluteY());
+void Cpu::Las(uint8_t value) {
+  value &= SP;
   A = value;
   X = value;
   SP = value;
   UpdateNZ(value);
 }
 
-void Cpu::LaxZeroPage() { Lax(ZeroPage()); }
-
-void Cpu::LaxZeroPageY() { Lax(ZeroPageY()); }
-
-void Cpu::LaxAbsolute() { Lax(Absolute()); }
-
-void Cpu::LaxAbsoluteY() { Lax(AbsoluteY()); }
-
-void Cpu::LaxIndirectX() { Lax(IndirectX()); }
-
-void Cpu::LaxIndirectY() { Lax(IndirectYW()); }
-
-void Cpu::Lax(uint16_t addr) {
-  A = ReadMemory(addr);
+void Cpu::Lax(uint8_t value) {
+  A = value;
   X = A;
   UpdateNZ(A);
 }
 
-void Cpu::LxaImmediate() {
-  uint8_t value = Fetch();
+void Cpu::Lxa(uint8_t value) {
   A = value & 0xFF;
   X = A;
   UpdateNZ(A);
 }
 
-void Cpu::RlaZeroPage() { Rla(ZeroPage()); }
-
-void Cpu::RlaZeroPageX() { Rla(ZeroPageX()); }
-
-void Cpu::RlaAbsolute() { Rla(Absolute()); }
-
-void Cpu::RlaAbsoluteX() { Rla(AbsoluteXW()); }
-
-void Cpu::RlaAbsoluteY() { Rla(AbsoluteYW()); }
-
-void Cpu::RlaIndirectX() { Rla(IndirectX()); }
-
-void Cpu::RlaIndirectY() { Rla(IndirectYW()); }
-
-void Cpu::Rla(uint16_t addr) {
-  uint8_t value = ReadMemory(addr);
-  WriteMemory(addr, value);
-  bool carry = static_cast<uint8_t>(flag_C);
-  flag_C = static_cast<bool>((value >> 7) & 0x1);
+uint8_t Cpu::Rla(uint8_t value) {
+  bool carry = FlagC();
+  SetFlag(FLAG_C, static_cast<bool>((value >> 7) & 0x1));
   value = (value << 1) | carry;
   A &= value;
   UpdateNZ(A);
-  WriteMemory(addr, value);
+  return value;
 }
 
-void Cpu::RraZeroPage() { Rra(ZeroPage()); }
-
-void Cpu::RraZeroPageX() { Rra(ZeroPageX()); }
-
-void Cpu::RraAbsolute() { Rra(Absolute()); }
-
-void Cpu::RraAbsoluteX() { Rra(AbsoluteXW()); }
-
-void Cpu::RraAbsoluteY() { Rra(AbsoluteYW()); }
-
-void Cpu::RraIndirectX() { Rra(IndirectX()); }
-
-void Cpu::RraIndirectY() { Rra(IndirectYW()); }
-
-void Cpu::Rra(uint16_t addr) {
-  uint8_t value = ReadMemory(addr);
-  WriteMemory(addr, value);
-  bool carry = static_cast<uint8_t>(flag_C);
-  flag_C = static_cast<bool>(value & 0x1);
+uint8_t Cpu::Rra(uint8_t value) {
+  bool carry = FlagC();
+  SetFlag(FLAG_C, static_cast<bool>(value & 0x1));
   value = (carry << 7) | (value >> 1);
   uint16_t result = static_cast<uint16_t>(A) + static_cast<uint16_t>(value) +
-                    static_cast<uint16_t>(flag_C);
-  flag_V = static_cast<bool>(
+                    static_cast<uint16_t>(P & FLAG_C);
+  SetFlag(FLAG_V, static_cast<bool>(
       ~(static_cast<uint16_t>(A) ^ static_cast<uint16_t>(value)) &
-      (static_cast<uint16_t>(A) ^ static_cast<uint16_t>(result)) & 0x80);
-  flag_C = static_cast<bool>(result & 0x100);
+      (static_cast<uint16_t>(A) ^ static_cast<uint16_t>(result)) & 0x80));
+  SetFlag(FLAG_C, static_cast<bool>(result & 0x100));
   A = static_cast<uint8_t>(result & 0xFF);
   UpdateNZ(A);
-  WriteMemory(addr, value);
+  return value;
 }
 
-void Cpu::SaxZeroPage() { Sax(ZeroPage()); }
-
-void Cpu::SaxZeroPageY() { Sax(ZeroPageY()); }
-
-void Cpu::SaxAbsolute() { Sax(Absolute()); }
+uint8_t Cpu::Sax(uint16_t /*addr*/) { return A & X; }
 
-void Cpu::SaxIndirectX() { Sax(IndirectX()); }
-
-void Cpu::Sax(uint16_t addr) { WriteMemory(addr, A & X); }
-
-void Cpu::SbxImmediate() {
+void Cpu::Sbx(uint8_t value) {
   int16_t result = (static_cast<int16_t>(A) & static_cast<int16_t>(X)) -
-                   static_cast<int16_t>(Fetch());
-  flag_C = static_cast<bool>(result >= 0);
-  flag_Z = result == 0;
+                   static_cast<int16_t>(value);
+  SetFlag(FLAG_C, static_cast<bool>(result >= 0));
   X = static_cast<uint8_t>(result & 0xFF);
-  flag_N = static_cast<bool>((result >> 7) & 0x1);
+  UpdateNZ(X);
 }
 
-void Cpu::ShaAbsoluteY() { Sha(AbsoluteYW()); }
-
-void Cpu::ShaIndirectY() { Sha(IndirectYW()); }
-
-void Cpu::Sha(uint16_t addr) {
-  WriteMemory(addr, A & X & (static_cast<uint8_t>(addr >> 8) + 1));
+uint8_t Cpu::Sha(uint16_t addr) {
+  return A & X & (static_cast<uint8_t>(addr >> 8) + 1);
 }
 
 void Cpu::ShxAbsoluteY() {
@@ -2175,7 +1303,7 @@ void Cpu::ShxAbsoluteY() {
   uint8_t hi = Fetch();
   bool inc = static_cast<uint16_t>(lo) + static_cast<uint16_t>(Y) > 0xFF;
   lo += Y;
-  ReadMemory((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
+  DummyRead((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
   if (inc) {
     hi &= X;
   }
@@ -2188,7 +1316,7 @@ void Cpu::ShyAbsoluteX() {
   uint8_t hi = Fetch();
   bool inc = (static_cast<uint16_t>(lo) + X) > 0xFF;
   lo += X;
-  ReadMemory((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
+  DummyRead((static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(lo));
   if (inc) {
     hi &= Y;
   }
@@ -2196,120 +1324,268 @@ void Cpu::ShyAbsoluteX() {
               Y & (hi + 1));
 }
 
-void Cpu::SloZeroPage() { Slo(ZeroPage()); }
-
-void Cpu::SloZeroPageX() { Slo(ZeroPageX()); }
-
-void Cpu::SloAbsolute() { Slo(Absolute()); }
-
-void Cpu::SloAbsoluteX() { Slo(AbsoluteXW()); }
-
-void Cpu::SloAbsoluteY() { Slo(AbsoluteYW()); }
-
-void Cpu::SloIndirectX() { Slo(IndirectX()); }
-
-void Cpu::SloIndirectY() { Slo(IndirectYW()); }
-
-void Cpu::Slo(uint16_t addr) {
-  uint8_t value = ReadMemory(addr);
-  WriteMemory(addr, value);
-  flag_C = static_cast<bool>((value >> 7) & 0x1);
+uint8_t Cpu::Slo(uint8_t value) {
+  SetFlag(FLAG_C, static_cast<bool>((value >> 7) & 0x1));
   value <<= 1;
   A |= value;
   UpdateNZ(A);
-  WriteMemory(addr, value);
+  return value;
 }
 
-void Cpu::SreZeroPage() { Sre(ZeroPage()); }
-
-void Cpu::SreZeroPageX() { Sre(ZeroPageX()); }
-
-void Cpu::SreAbsolute() { Sre(Absolute()); }
-
-void Cpu::SreAbsoluteX() { Sre(AbsoluteXW()); }
-
-void Cpu::SreAbsoluteY() { Sre(AbsoluteY()); }
-
-void Cpu::SreIndirectX() { Sre(IndirectX()); }
-
-void Cpu::SreIndirectY() { Sre(IndirectYW()); }
-
-void Cpu::Sre(uint16_t addr) {
-  uint8_t value = ReadMemory(addr);
-  WriteMemory(addr, value);
-  flag_C = static_cast<bool>(value & 0x1);
+uint8_t Cpu::Sre(uint8_t value) {
+  SetFlag(FLAG_C, static_cast<bool>(value & 0x1));
   value >>= 1;
   A ^= value;
   UpdateNZ(A);
-  WriteMemory(addr, value);
+  return value;
 }
 
-void Cpu::TasAbsoluteY() {
-  uint16_t addr = AbsoluteY();
+uint8_t Cpu::Tas(uint16_t addr) {
   SP = A & X;
-  WriteMemory(addr, A & X & (static_cast<uint8_t>(addr >> 8) + 1));
+  return A & X & (static_cast<uint8_t>(addr >> 8) + 1);
 }
 
 void Cpu::NopImplied() { AddCycle(); }
 
 void Cpu::NopImmediate() { Fetch(); }
 
-void Cpu::NopZeroPage() { ZeroPage(); }
-
-void Cpu::NopZeroPageX() { ZeroPageX(); }
-
-void Cpu::NopAbsolute() { Absolute(); }
-
-void Cpu::NopAbsoluteX() { AbsoluteX(); }
-
 void Cpu::Stp() { stopped = true; }
 
 /*****************************************************************
    Utility
  *****************************************************************/
 
-bool Cpu::NmiPending() { return mmu.NmiPending(); }
-
-bool Cpu::IrqPending() { return mmu.IrqPending(); }
-
 void Cpu::Push(uint8_t value) {
-  WriteMemory(0x0100 | static_cast<uint16_t>(SP--), value);
+  WriteRam(0x0100 | static_cast<uint16_t>(SP--), value);
 }
 
 uint8_t Cpu::Pull(uint8_t SP) {
-  return ReadMemory(0x0100 | static_cast<uint16_t>(SP));
+  return ReadRam(0x0100 | static_cast<uint16_t>(SP));
 }
 
 void Cpu::UpdateNZV(uint8_t old, uint8_t byte) {
   UpdateNZ(byte);
   bool old7 = static_cast<bool>(old >> 7);
   bool new7 = static_cast<bool>(byte >> 7);
-  flag_V = (!old7 && !new7 && flag_C) || (old7 && new7 && !flag_C);
+  SetFlag(FLAG_V, (!old7 && !new7 && FlagC()) || (old7 && new7 && !FlagC()));
+}
+
+void Cpu::SetNZ(bool n, bool z) {
+  nz_result = (static_cast<uint16_t>(n) << 8) | static_cast<uint16_t>(!z);
 }
 
-void Cpu::UpdateNZ(uint8_t byte) {
-  flag_N = static_cast<bool>(byte >> 7);
-  flag_Z = byte == 0;
+uint8_t Cpu::Status() {
+  return P | (static_cast<uint8_t>(FlagN()) << 7) |
+         (static_cast<uint8_t>(FlagZ()) << 1);
+}
+
+void Cpu::SetStatus(uint8_t status) {
+  P = status & (FLAG_V | FLAG_D | FLAG_I | FLAG_C);
+  SetNZ(static_cast<bool>(status & FLAG_N),
+        static_cast<bool>(status & FLAG_Z));
 }
 
 uint8_t Cpu::ReadMemory(uint16_t addr) {
   AddCycle();
+
+  if (addr >= 0x2000) {
+    bool status = addr < 0x4000 && (addr & 0x7) == 0x2;
+    idle_pure &= status;
+    idle_status |= status;
+  }
+
+  if (Watched(addr) & (WATCH_READ | WATCH_COVERAGE)) {
+    CheckAccess(addr, WATCH_READ);
+  }
+
   return mmu.Read(addr);
 }
 
+/*
+  Only the PPU, APU and controller registers (and some mappers) can tell
+  that a read happened. Elsewhere a dummy read just takes its cycle.
+*/
+void Cpu::DummyRead(uint16_t addr) {
+  if (!mmu.SideEffectFree(addr)) {
+    ReadMemory(addr);
+    return;
+  }
+
+  AddCycle();
+  idle_pure &= addr < 0x2000;
+  mmu.CountRead(addr);
+
+  if (Watched(addr) & (WATCH_READ | WATCH_COVERAGE)) {
+    CheckAccess(addr, WATCH_READ);
+  }
+}
+
 void Cpu::WriteMemory(uint16_t addr, uint8_t value) {
   AddCycle();
+  idle_pure = false;
+
+  if (Watched(addr) & WATCH_WRITE) {
+    CheckAccess(addr, WATCH_WRITE);
+  }
+
   mmu.Write(addr, value);
 }
 
+uint8_t Cpu::ReadRam(uint16_t addr) {
+  AddCycle();
+  mmu.CountRead(addr);
+
+  if (Watched(addr) & WATCH_READ) {
+    CheckAccess(addr, WATCH_READ);
+  }
+
+  return ram[addr];
+}
+
+void Cpu::WriteRam(uint16_t addr, uint8_t value) {
+  AddCycle();
+  idle_pure = false;
+  mmu.CountWrite(addr);
+
+  if (Watched(addr) & WATCH_WRITE) {
+    CheckAccess(addr, WATCH_WRITE);
+  }
+
+  ram[addr] = value;
+}
+
+/*
+  A breakpoint sets events::BREAKPOINT, which stops RunTillEvent once the
+  current instruction is over. Execution breakpoints are checked before the
+  instruction starts, so nothing of it has run yet. Coverage is recorded
+  here too, for instructions and reads on the pages it marks.
+*/
+bool Cpu::CheckInstruction() {
+  if (coverage != nullptr && PC >= 0x8000) {
+    coverage->Execute(PC, OPCODE_LENGTHS[mmu.Peek(PC)]);
+  }
+
+  if (!breakpoints.Test(PC, WATCH_EXEC)) {
+    return false;
+  }
+
+  if (breakpoint_resume == PC) {
+    breakpoint_resume = -1;
+    return false;
+  }
+
+  breakpoint_resume = PC;
+  breakpoint_hit = {WATCH_EXEC, PC};
+  mmu.SetBreakpointEvent(true);
+  return true;
+}
+
+void Cpu::CheckAccess(uint16_t addr, uint8_t kind) {
+  if (kind == WATCH_READ && coverage != nullptr && addr >= 0x8000) {
+    coverage->Read(addr);
+  }
+
+  if (breakpoints.Test(addr, kind)) {
+    breakpoint_hit = {kind, addr};
+    mmu.SetBreakpointEvent(true);
+  }
+}
+
+/*
+  Instructions executed from PRG-ROM are served from the decode cache: the
+  opcode and operands come from the cache instead of the mapper, but every
+  byte still costs its cycle. On a miss the bytes are recorded as Fetch reads
+  them and stored once the next instruction starts.
+*/
+uint8_t Cpu::FetchOpcode() {
+  if constexpr (PROFILE_ENABLED) {
+    if (sampler != nullptr) {
+      sampler->Sample(PC, cycles);
+    }
+  }
+
+  if (idle_state == IdleState::Armed || idle_state == IdleState::Recording) {
+    TrackIdleLoop();
+  }
+
+  if (Tracing()) {
+    RecordTrace();
+  }
+
+  if (decode_miss) {
+    decode_cache.Store(fetched, fetched_count);
+    decode_miss = false;
+  }
+
+  uint64_t start = cycles;
+  uint8_t value;
+  const DecodedInstruction* decoded = decode_cache.Lookup(PC);
+
+  if (decoded != nullptr) {
+    cached_operands = &decoded->bytes[1];
+    cached_operands_left = decoded->length - 1;
+    AddCycle();
+    PC++;
+    value = decoded->bytes[0];
+  } else {
+    decode_miss = PC >= 0x8000;
+    cached_operands_left = 0;
+    fetched_count = 0;
+    value = Fetch();
+  }
+
+  if constexpr (PROFILE_ENABLED) {
+    profile.Begin(value, start);
+  }
+
+  return value;
+}
+
 uint8_t Cpu::Fetch() {
   AddCycle();
-  return mmu.Read(PC++);
+
+  if (cached_operands_left > 0) {
+    cached_operands_left--;
+    PC++;
+    return *cached_operands++;
+  }
+
+  uint8_t value = mmu.Read(PC++);
+  fetched[fetched_count++ & 0x3] = value;
+  return value;
+}
+
+void Cpu::RecordTrace() {
+  TraceRecord record = {};
+  record.cycle = cycles;
+  record.PC = PC;
+  record.dot = static_cast<uint16_t>(mmu.PpuDot());
+  record.line = static_cast<uint16_t>(mmu.PpuLine());
+  record.opcode = mmu.Peek(PC);
+  record.operands[0] = mmu.Peek(PC + 1);
+  record.operands[1] = mmu.Peek(PC + 2);
+  record.A = A;
+  record.X = X;
+  record.Y = Y;
+  record.P = Status() | FLAG_U;
+  record.SP = SP;
+  trace->Record(record);
 }
 
 void Cpu::AddCycle() {
-  if (mmu.StallCpu()) {
+  if (jit_replay) {
+    replay_cycles++;
+    return;
+  }
+
+  if (mmu.Pending() & events::DMC_STALL) {
     uint64_t n = mmu.InDma() ? 2 : 4;
+    idle_pure = false;
+
+    if constexpr (PROFILE_ENABLED) {
+      profile.dmc_stall_cycles += n - 1;
+    }
+
     cycles += n;
     event_cycles += n;
     mmu.PpuTick(3 * n);
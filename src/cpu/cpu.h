@@ -1,24 +1,79 @@
 #ifndef SRC_CPU_CPU_H_
 #define SRC_CPU_CPU_H_
 
+#include <array>
 #include <cstdint>
-#include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "src/apu/apu.h"
+#include "src/cpu/breakpoints.h"
+#include "src/cpu/coverage.h"
+#include "src/cpu/decode_cache.h"
 #include "src/cpu/event.h"
+#include "src/cpu/jit.h"
+#include "src/cpu/opcodes.h"
+#include "src/cpu/profile.h"
+#include "src/cpu/sampler.h"
+#include "src/cpu/trace.h"
+#include "src/events/events.h"
+#include "src/features/features.h"
 #include "src/memory/memory.h"
 
 namespace cpu {
 
+// Processor status bits
+constexpr uint8_t FLAG_C = 0x01;
+constexpr uint8_t FLAG_Z = 0x02;
+constexpr uint8_t FLAG_I = 0x04;
+constexpr uint8_t FLAG_D = 0x08;
+constexpr uint8_t FLAG_B = 0x10;
+constexpr uint8_t FLAG_U = 0x20;
+constexpr uint8_t FLAG_V = 0x40;
+constexpr uint8_t FLAG_N = 0x80;
+
 enum class InterruptType {
   Nmi,
   Irq,
 };
 
+// instructions in the longest loop the idle loop detector looks for
+constexpr int IDLE_MAX_STEPS = 8;
+
+enum class IdleState {
+  Off,
+  // a backward branch was taken, recording starts with the next instruction
+  Armed,
+  Recording,
+  Confirmed,
+};
+
+// Registers after one instruction of an idle loop, and the cycles it took.
+struct IdleStep {
+  uint16_t PC;
+  uint8_t A;
+  uint8_t X;
+  uint8_t Y;
+  uint8_t SP;
+  uint8_t P;
+  uint16_t nz_result;
+  uint64_t cycles;
+};
+
+// The registers as a debugger sees them.
+struct Registers {
+  uint16_t PC;
+  uint8_t A;
+  uint8_t X;
+  uint8_t Y;
+  uint8_t SP;
+  // with B and the unused bit clear
+  uint8_t P;
+};
+
 enum class DmaState {
   PreDma,
   OddCycleWait,
@@ -44,15 +99,91 @@ class Cpu {
   void UseFceuxPalette() { mmu.UseFceuxPalette(); }
   void UseNtscPalette() { mmu.UseNtscPalette(); }
   std::vector<int16_t> GetAudioBuffer() { return mmu.apu.GetAudioBuffer(); }
+  uint64_t Instructions() { return instructions; }
+  uint64_t DecodeCacheHits() { return decode_cache.hits; }
+  uint64_t DecodeCacheMisses() { return decode_cache.misses; }
+  void SetJitMode(JitMode mode);
+  // see memory::PpuSync; lazy by default
+  void SetPpuSync(memory::PpuSync sync) { mmu.SetPpuSync(sync); }
+  uint64_t JitInstructions() { return jit_instructions; }
+  uint64_t JitBlocks() { return jit ? jit->blocks_compiled : 0; }
+  uint64_t IdleCycles() { return idle_cycles; }
+  // Records every instruction to a binary trace file until StopTrace. The
+  // JIT and idle loop skipping are bypassed meanwhile. Not available in
+  // lean builds (see src/features/features.h), nor are breakpoints and
+  // coverage.
+  void StartTrace(const std::string& path);
+  void StopTrace() { trace.reset(); }
+  // Counters collected in builds with NESEMU_FEATURES_FULL, all zero
+  // otherwise.
+  const Profile& GetProfile();
+  // Samples the guest PC every `interval` cycles from now on (see
+  // sampler.h). Needs a build with NESEMU_FEATURES_FULL.
+  void StartSampling(uint64_t interval);
+  Sampler* GetSampler() { return sampler.get(); }
+  // Writes per-frame read and write counts of every RAM and PRG-RAM address
+  // to a file (see src/memory/heatmap.h) until StopHeatmap. Bypasses the
+  // JIT and idle loop skipping like tracing does. Needs a build with
+  // NESEMU_FEATURES_FULL.
+  void StartHeatmap(const std::string& path);
+  void StopHeatmap() { mmu.StopHeatmap(); }
+  // Stops RunTillEvent with Event::Breakpoint before an instruction at addr
+  // runs (WATCH_EXEC) or once one that read or wrote addr has finished
+  // (WATCH_READ, WATCH_WRITE). Resuming runs the instruction stopped at. The
+  // JIT and idle loop skipping are bypassed while anything is set.
+  void SetBreakpoint(uint16_t addr, uint8_t kinds);
+  void ClearBreakpoint(uint16_t addr, uint8_t kinds);
+  const BreakpointHit& LastBreakpoint() { return breakpoint_hit; }
+  Registers GetRegisters();
+  // Records which PRG-ROM bytes are executed or read from now on (see
+  // coverage.h). Like breakpoints, this bypasses the JIT and idle loop
+  // skipping.
+  void StartCoverage();
+  Coverage* GetCoverage() { return coverage.get(); }
+  // Applies a Game Genie or raw addr:value[:compare] code to what the CPU
+  // reads from 0x8000-0xFFFF (see src/mappers/cheats.h). Reads stay on the
+  // page table's fast path; the JIT and decode cache only leave the patched
+  // bytes to the interpreter.
+  void AddCheat(const std::string& code);
+  void ClearCheats() { mmu.Cartridge()->ClearCheats(); }
+  // Publishes the screen, RAM, OAM, palette RAM and registers to a POSIX
+  // shared memory object at every VBlank until StopSharedState (see
+  // src/memory/shared_state.h).
+  void StartSharedState(const std::string& name) {
+    mmu.StartSharedState(name);
+  }
+  void StopSharedState() { mmu.StopSharedState(); }
+  // For memory::RamSearch.
+  void SnapshotWorkRam(memory::WorkRam& snapshot) {
+    mmu.SnapshotWorkRam(snapshot);
+  }
+  uint8_t Peek(uint16_t addr) { return mmu.Peek(addr); }
 
   // controller
   uint8_t p1_input = 0x00;
-  std::ofstream myfile;
 
  private:
   void RunDma();
 
   void DecodeExecute(uint8_t opcode);
+#if defined(NESEMU_DISPATCH_TABLE)
+  using Handler = void (Cpu::*)();
+  static const Handler OPCODE_TABLE[256];
+#endif
+  bool CanChain();
+
+  /* JIT */
+  bool RunCompiled();
+  void CheckCompiled(const JitState& entry, const JitState& compiled);
+  JitState SaveJitState();
+  void LoadJitState(const JitState& state);
+
+  /* Idle loops */
+  void WatchIdleLoop(uint16_t target);
+  void TrackIdleLoop();
+  void SkipIdleLoop();
+  IdleStep SaveIdleStep();
+  void LoadIdleStep(const IdleStep& step);
 
   /* Addressing */
   uint16_t IndirectX();
@@ -67,50 +198,37 @@ class Cpu {
   uint16_t AbsoluteXW();
   uint16_t AbsoluteYW();
 
-  /* LDA */
-  void LdaImmediate();
-  void LdaZeroPage();
-  void LdaZeroPageX();
-  void LdaAbsolute();
-  void LdaAbsoluteX();
+  /* Instruction templates (operation x addressing mode) */
+  template <void (Cpu::*Op)(uint8_t)>
+  void Immediate();
+  template <void (Cpu::*Op)(uint8_t), uint16_t (Cpu::*Mode)()>
+  void Read();
+  template <uint8_t (Cpu::*Op)(uint16_t), uint16_t (Cpu::*Mode)()>
+  void Write();
+  template <uint8_t (Cpu::*Op)(uint8_t), uint16_t (Cpu::*Mode)()>
+  void Modify();
+  template <uint8_t (Cpu::*Op)(uint8_t)>
+  void Accumulator();
+  template <uint16_t (Cpu::*Mode)()>
+  void Nop();
+  // Zero page modes always land in internal RAM and skip the memory map.
+  template <uint16_t (Cpu::*Mode)()>
+  static constexpr bool ZeroPageMode();
+  template <uint16_t (Cpu::*Mode)()>
+  uint8_t ReadOperand(uint16_t addr);
+  template <uint16_t (Cpu::*Mode)()>
+  void WriteOperand(uint16_t addr, uint8_t value);
+
+  /* Loads */
+  void Lda(uint8_t value);
   void LdaAbsoluteY();
-  void LdaIndirectX();
-  void LdaIndirectY();
-
-  /* LDX */
-  void LdxImmediate();
-  void LdxZeroPage();
-  void LdxZeroPageY();
-  void LdxAbsolute();
-  void LdxAbsoluteY();
-  void Ldx(uint16_t addr);
-
-  /* LDY */
-  void LdyImmediate();
-  void LdyZeroPage();
-  void LdyZeroPageX();
-  void LdyAbsolute();
-  void LdyAbsoluteX();
-  void Ldy(uint16_t addr);
-
-  /* STA */
-  void StaZeroPage();
-  void StaZeroPageX();
-  void StaAbsolute();
-  void StaAbsoluteX();
-  void StaAbsoluteY();
-  void StaIndirectX();
-  void StaIndirectY();
-
-  /* STX */
-  void StxZeroPage();
-  void StxZeroPageY();
-  void StxAbsolute();
-
-  /* STY */
-  void StyZeroPage();
-  void StyZeroPageX();
-  void StyAbsolute();
+  void Ldx(uint8_t value);
+  void Ldy(uint8_t value);
+
+  /* Stores */
+  uint8_t Sta(uint16_t addr);
+  uint8_t Stx(uint16_t addr);
+  uint8_t Sty(uint16_t addr);
 
   /* TAX */
   void TaxImplied();
@@ -135,22 +253,14 @@ class Cpu {
   void PlpImplied();
 
   /* DEC */
-  void DecZeroPage();
-  void DecZeroPageX();
-  void DecAbsolute();
-  void DecAbsoluteX();
-  void Dec(uint16_t addr, uint8_t value);
+  uint8_t Dec(uint8_t value);
   /* DEX */
   void DexImplied();
   /* DEY */
   void DeyImplied();
 
   /* INC */
-  void IncZeroPage();
-  void IncZeroPageX();
-  void IncAbsolute();
-  void IncAbsoluteX();
-  void Inc(uint16_t addr, uint8_t value);
+  uint8_t Inc(uint8_t value);
   /* INX */
   void InxImplied();
   /* INY */
@@ -158,91 +268,21 @@ class Cpu {
 
   /* ADC */
   bool Overflow(int8_t reg, int8_t value, int8_t carry);
-  void AdcImmediate();
-  void AdcZeroPage();
-  void AdcZeroPageX();
-  void AdcAbsolute();
-  void AdcAbsoluteX();
-  void AdcAbsoluteY();
-  void AdcIndirectX();
-  void AdcIndirectY();
   void Adc(uint8_t value);
-
   /* SBC */
-  void SbcImmediate();
-  void SbcZeroPage();
-  void SbcZeroPageX();
-  void SbcAbsolute();
-  void SbcAbsoluteX();
-  void SbcAbsoluteY();
-  void SbcIndirectX();
-  void SbcIndirectY();
   void Sbc(uint8_t value);
-
   /* AND */
-  void AndImmediate();
-  void AndZeroPage();
-  void AndZeroPageX();
-  void AndAbsolute();
-  void AndAbsoluteX();
-  void AndAbsoluteY();
-  void AndIndirectX();
-  void AndIndirectY();
   void And(uint8_t value);
-
   /* EOR */
-  void EorImmediate();
-  void EorZeroPage();
-  void EorZeroPageX();
-  void EorAbsolute();
-  void EorAbsoluteX();
-  void EorAbsoluteY();
-  void EorIndirectX();
-  void EorIndirectY();
   void Eor(uint8_t value);
-
   /* ORA */
-  void OraImmediate();
-  void OraZeroPage();
-  void OraZeroPageX();
-  void OraAbsolute();
-  void OraAbsoluteX();
-  void OraAbsoluteY();
-  void OraIndirectX();
-  void OraIndirectY();
   void Ora(uint8_t value);
 
-  /* ASL */
-  void AslAccumulator();
-  void AslZeroPage();
-  void AslZeroPageX();
-  void AslAbsolute();
-  void AslAbsoluteX();
-  void Asl(uint16_t addr, uint8_t value);
-
-  /* LSR */
-  void LsrAccumulator();
-  void LsrZeroPage();
-  void LsrZeroPageX();
-  void LsrAbsolute();
-  void LsrAbsoluteX();
-  void Lsr(uint16_t addr, uint8_t value);
-
-  /* ROL */
-  void RolAccumulator();
-  void RolZeroPage();
-  void RolZeroPageX();
-  void RolAbsolute();
-  void RolAbsoluteX();
-  void Rol(uint16_t addr, uint8_t value);
-
-  /* ROR */
-  void RorAccumulator();
-  void RorZeroPage();
-  void RorZeroPageX();
-  void RorAbsolute();
-  void RorAbsoluteX();
-  void Ror(uint16_t addr, uint8_t value);
+  /* Shifts and rotates */
+  uint8_t Asl(uint8_t value);
+  uint8_t Lsr(uint8_t value);
+  uint8_t Rol(uint8_t value);
+  uint8_t Ror(uint8_t value);
 
   /* Flag Instructions */
   void ClcImplied();
@@ -252,29 +292,13 @@ class Cpu {
   void SecImplied();
   void SedImplied();
   void SeiImplied();
-  void UpdateFlag(bool& flag, bool value);
-
-  /* CMP */
-  void CmpImmediate();
-  void CmpZeroPage();
-  void CmpZeroPageX();
-  void CmpAbsolute();
-  void CmpAbsoluteX();
-  void CmpAbsoluteY();
-  void CmpIndirectX();
-  void CmpIndirectY();
-
-  /* CPX */
-  void CpxImmediate();
-  void CpxZeroPage();
-  void CpxAbsolute();
-
-  /* CPY */
-  void CpyImmediate();
-  void CpyZeroPage();
-  void CpyAbsolute();
-
-  void Cmp(uint8_t reg, uint8_t value);
+  void UpdateFlag(uint8_t flag, bool value);
+
+  /* CMP, CPX, CPY */
+  void Cmp(uint8_t value);
+  void Cpx(uint8_t value);
+  void Cpy(uint8_t value);
+  void Compare(uint8_t reg, uint8_t value);
 
   /* Conditional Branch Instructions */
   void BccRelative();
@@ -299,128 +323,142 @@ class Cpu {
   void Interrupt(InterruptType type);
 
   /* BIT */
-  void BitZeroPage();
-  void BitAbsolute();
-  void Bit(uint16_t addr);
+  void Bit(uint8_t value);
 
   /* Illegal Opcodes */
-  void AlrImmediate();
-  void AncImmediate();
-  void AneImmediate();
-  void ArrImmediate();
-
-  void DcpZeroPage();
-  void DcpZeroPageX();
-  void DcpAbsolute();
-  void DcpAbsoluteX();
-  void DcpAbsoluteY();
-  void DcpIndirectX();
-  void DcpIndirectY();
-  void Dcp(uint16_t addr);
-
-  void IscZeroPage();
-  void IscZeroPageX();
-  void IscAbsolute();
-  void IscAbsoluteX();
-  void IscAbsoluteY();
-  void IscIndirectX();
-  void IscIndirectY();
-  void Isc(uint16_t addr);
-
-  void LasAbsoluteY();
-
-  void LaxZeroPage();
-  void LaxZeroPageY();
-  void LaxAbsolute();
-  void LaxAbsoluteY();
-  void LaxIndirectX();
-  void LaxIndirectY();
-  void Lax(uint16_t addr);
-
-  void LxaImmediate();
-
-  void RlaZeroPage();
-  void RlaZeroPageX();
-  void RlaAbsolute();
-  void RlaAbsoluteX();
-  void RlaAbsoluteY();
-  void RlaIndirectX();
-  void RlaIndirectY();
-  void Rla(uint16_t addr);
-
-  void RraZeroPage();
-  void RraZeroPageX();
-  void RraAbsolute();
-  void RraAbsoluteX();
-  void RraAbsoluteY();
-  void RraIndirectX();
-  void RraIndirectY();
-  void Rra(uint16_t addr);
-
-  void SaxZeroPage();
-  void SaxZeroPageY();
-  void SaxAbsolute();
-  void SaxIndirectX();
-  void Sax(uint16_t addr);
-
-  void SbxImmediate();
-
-  void ShaAbsoluteY();
-  void ShaIndirectY();
-  void Sha(uint16_t addr);
-
+  void Alr(uint8_t value);
+  void Anc(uint8_t value);
+  void Ane(uint8_t value);
+  void Arr(uint8_t value);
+  uint8_t Dcp(uint8_t value);
+  uint8_t Isc(uint8_t value);
+  void Las(uint8_t value);
+  void Lax(uint8_t value);
+  void Lxa(uint8_t value);
+  uint8_t Rla(uint8_t value);
+  uint8_t Rra(uint8_t value);
+  uint8_t Sax(uint16_t addr);
+  void Sbx(uint8_t value);
+  uint8_t Sha(uint16_t addr);
   void ShxAbsoluteY();
   void ShyAbsoluteX();
-
-  void SloZeroPage();
-  void SloZeroPageX();
-  void SloAbsolute();
-  void SloAbsoluteX();
-  void SloAbsoluteY();
-  void SloIndirectX();
-  void SloIndirectY();
-  void Slo(uint16_t addr);
-
-  void SreZeroPage();
-  void SreZeroPageX();
-  void SreAbsolute();
-  void SreAbsoluteX();
-  void SreAbsoluteY();
-  void SreIndirectX();
-  void SreIndirectY();
-  void Sre(uint16_t addr);
-
-  void TasAbsoluteY();
+  uint8_t Slo(uint8_t value);
+  uint8_t Sre(uint8_t value);
+  uint8_t Tas(uint16_t addr);
 
   void NopImplied();
   void NopImmediate();
-  void NopZeroPage();
-  void NopZeroPageX();
-  void NopAbsolute();
-  void NopAbsoluteX();
 
   void Stp();
 
   /* Utility methods */
-  bool NmiPending();
-  bool IrqPending();
   void Push(uint8_t value);
   uint8_t Pull(uint8_t SP);
   void UpdateNZV(uint8_t old, uint8_t byte);
-  void UpdateNZ(uint8_t byte);
+  void UpdateNZ(uint8_t byte) { nz_result = byte; }
+  bool FlagN() { return static_cast<bool>(nz_result & 0x180); }
+  bool FlagZ() { return (nz_result & 0xFF) == 0; }
+  bool FlagV() { return static_cast<bool>(P & FLAG_V); }
+  bool FlagD() { return static_cast<bool>(P & FLAG_D); }
+  bool FlagI() { return static_cast<bool>(P & FLAG_I); }
+  bool FlagC() { return static_cast<bool>(P & FLAG_C); }
+  void SetFlag(uint8_t flag, bool value) {
+    P = value ? P | flag : P & ~flag;
+  }
+  void SetNZ(bool n, bool z);
+  // P with N and Z filled in; B and the unused bit are left clear.
+  uint8_t Status();
+  void SetStatus(uint8_t status);
+  uint8_t FetchOpcode();
   uint8_t Fetch();
+  void RecordTrace();
+  bool Tracing() { return features::ENABLED.trace && trace != nullptr; }
+  // Something needs to see every instruction or memory access.
+  bool Observed() {
+    return Tracing() || WatchArmed() || mmu.HeatmapRunning();
+  }
+  // WATCH_* kinds set on the page of addr
+  uint8_t Watched(uint16_t addr) {
+    return features::ENABLED.breakpoints ? breakpoints.pages[addr >> 8] : 0;
+  }
+  bool WatchArmed() {
+    return features::ENABLED.breakpoints && breakpoints.Armed();
+  }
+  bool CheckInstruction();
+  void CheckAccess(uint16_t addr, uint8_t kind);
 
   uint8_t ReadMemory(uint16_t addr);
+  // A read whose value is thrown away, as in indexed addressing.
+  void DummyRead(uint16_t addr);
   void WriteMemory(uint16_t addr, uint8_t value);
+  // For zero page and stack addresses only.
+  uint8_t ReadRam(uint16_t addr);
+  void WriteRam(uint16_t addr, uint8_t value);
 
   void AddCycle();
 
   /* Memory */
   memory::Memory mmu;
+  // internal RAM, read and written directly by ReadRam and WriteRam
+  uint8_t* ram;
+
+  /* Decode cache */
+  DecodeCache decode_cache;
+  // operands of a cached instruction, handed out by Fetch
+  const uint8_t* cached_operands = nullptr;
+  uint8_t cached_operands_left = 0;
+  // bytes fetched by an instruction that missed the cache
+  std::array<uint8_t, 4> fetched;
+  uint8_t fetched_count = 0;
+  bool decode_miss = false;
+
+  /* JIT */
+  JitMode jit_mode = JitMode::Off;
+  std::unique_ptr<Jit> jit;
+  uint64_t jit_instructions = 0;
+  // while checking a block, AddCycle only counts
+  bool jit_replay = false;
+  uint32_t replay_cycles = 0;
+
+  /* Idle loops */
+  IdleState idle_state = IdleState::Off;
+  uint16_t idle_start = 0;
+  // start of the last loop that changed registers on every iteration
+  uint16_t idle_rejected = 0;
+  // registers at idle_start when the recorded iteration began
+  IdleStep idle_entry = {};
+  std::array<IdleStep, IDLE_MAX_STEPS> idle_steps;
+  int idle_length = 0;
+  uint64_t idle_step_cycles = 0;
+  // cycles of one iteration of the recorded loop
+  uint64_t idle_loop_cycles = 0;
+  // cleared by anything an idle loop may not do: writes, reads outside
+  // internal RAM other than of PPUSTATUS, and DMC stalls
+  bool idle_pure = false;
+  // set if the recorded loop reads PPUSTATUS
+  bool idle_status = false;
+  uint64_t idle_cycles = 0;
+
+  /* Tracing */
+  std::unique_ptr<Trace> trace;
+
+  /* Profiling */
+  Profile profile;
+  std::unique_ptr<Sampler> sampler;
+
+  /* Debugging */
+  Breakpoints breakpoints;
+  BreakpointHit breakpoint_hit = {};
+  // the execution breakpoint last stopped at, not stopped at again when the
+  // instruction runs on resuming
+  int32_t breakpoint_resume = -1;
+  std::unique_ptr<Coverage> coverage;
 
   /* Internal */
   uint64_t cycles = 0;
   uint64_t event_cycles = 0;
+  uint64_t chain_limit = 0;
+  uint64_t instructions = 0;
   DmaState dma_state = DmaState::PreDma;
   uint8_t opcode = 0;
   bool stopped = false;
@@ -433,12 +471,12 @@ class Cpu {
   uint16_t PC = 0x0;
 
   /* Flags (processor status) */
-  bool flag_N = false;
-  bool flag_V = false;
-  bool flag_D = false;
-  bool flag_I = true;
-  bool flag_Z = false;
-  bool flag_C = false;
+  // N and Z are worked out from this only when something reads them. The
+  // low byte is the last result (Z if zero, N from bit 7) and bit 8 forces
+  // N, for the times N and Z are set independently (BIT, PLP, RTI).
+  uint16_t nz_result = 0x01;
+  // V, D, I and C at their FLAG_* positions, everything else zero
+  uint8_t P = FLAG_I;
 };
 
 }  // namespace cpu
@@ -0,0 +1,83 @@
+#include "decode_cache.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "src/cpu/prg_rom_map.h"
+#include "src/mappers/mapper.h"
+
+namespace cpu {
+
+DecodeCache::DecodeCache(std::shared_ptr<mappers::Mapper> mapper)
+    : rom(std::move(mapper)),
+      entries(rom.Size() + PRG_SLOT_SIZE, DecodedInstruction{}) {}
+
+const DecodedInstruction* DecodeCache::Lookup(uint16_t addr) {
+  if (addr < 0x8000) {
+    // RAM and PRG-RAM always go through the normal fetch path
+    return nullptr;
+  }
+
+  rom.TakeRomWrites(
+      [this](uint64_t begin, uint64_t end) { Drop(begin, end); });
+
+  uint64_t offset = rom.Offset(addr);
+  const DecodedInstruction& entry = entries[offset];
+
+  if (entry.length == 0) {
+    misses++;
+    miss_addr = addr;
+    miss_offset = offset;
+    return nullptr;
+  }
+
+  hits++;
+  return &entry;
+}
+
+void DecodeCache::Store(const std::array<uint8_t, 4>& bytes, uint8_t length) {
+  uint16_t last = miss_addr + length - 1;
+  // the instruction may have written its own bytes while it ran
+  bool overwritten = false;
+
+  rom.TakeRomWrites(
+      [this, length, &overwritten](uint64_t begin, uint64_t end) {
+        Drop(begin, end);
+        overwritten |= begin < miss_offset + length && end > miss_offset;
+      });
+
+  if (overwritten) {
+    return;
+  }
+
+  if (length == 0 || length > 3 || (miss_addr & 0xF000) != (last & 0xF000) ||
+      miss_offset >= rom.Size()) {
+    return;
+  }
+
+  // bytes a cheat may patch are only right when read through the page table
+  for (int i = 0; i < length; i++) {
+    if (rom.MayBeCheated(miss_addr + i)) {
+      return;
+    }
+  }
+
+  DecodedInstruction& entry = entries[miss_offset];
+
+  entry.length = length;
+  for (int i = 0; i < length; i++) {
+    entry.bytes[i] = bytes[i];
+  }
+}
+
+void DecodeCache::Drop(uint64_t begin, uint64_t end) {
+  // an entry holds up to three bytes, starting at its own offset
+  for (uint64_t offset = begin < 2 ? 0 : begin - 2; offset < end; offset++) {
+    entries[offset].length = 0;
+  }
+}
+
+}  // namespace cpu
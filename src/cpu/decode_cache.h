@@ -0,0 +1,51 @@
+#ifndef SRC_CPU_DECODE_CACHE_H_
+#define SRC_CPU_DECODE_CACHE_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "src/cpu/prg_rom_map.h"
+#include "src/mappers/mapper.h"
+
+namespace cpu {
+
+struct DecodedInstruction {
+  // 0 if nothing has been decoded at this offset yet
+  uint8_t length;
+  // opcode followed by its operands
+  std::array<uint8_t, 3> bytes;
+};
+
+/*
+  Predecoded instructions for code running from PRG-ROM, keyed by PRG-ROM
+  offset (i.e. bank and offset within the bank). Bank switches only change
+  which offsets the CPU sees in each 4K slot of 0x8000-0xFFFF, so entries
+  survive them. A write to PRG-ROM drops the entries whose bytes it can
+  change, i.e. those of the written offset and the two before it.
+*/
+class DecodeCache {
+ public:
+  DecodeCache(std::shared_ptr<mappers::Mapper> mapper);
+
+  const DecodedInstruction* Lookup(uint16_t addr);
+  // Fills in the entry for the last Lookup that missed.
+  void Store(const std::array<uint8_t, 4>& bytes, uint8_t length);
+
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+
+ private:
+  // Drops the entries holding any byte of offsets [begin, end).
+  void Drop(uint64_t begin, uint64_t end);
+
+  PrgRomMap rom;
+  std::vector<DecodedInstruction> entries;
+  uint16_t miss_addr = 0;
+  uint64_t miss_offset = 0;
+};
+
+}  // namespace cpu
+
+#endif  // SRC_CPU_DECODE_CACHE_H_
@@ -8,6 +8,8 @@ enum class Event {
   MaxCycles,
   Stopped,
   AudioBufferFull,
+  // see Cpu::SetBreakpoint
+  Breakpoint,
 };
 
 }  // namespace cpu
@@ -0,0 +1,1270 @@
+#include "jit.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "src/cpu/prg_rom_map.h"
+#include "src/cpu/x64_emitter.h"
+#include "src/mappers/mapper.h"
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define NESEMU_JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace cpu {
+
+namespace {
+
+// block_index markers
+constexpr int32_t NO_BLOCK = -1;
+constexpr int32_t NOT_COMPILABLE = -2;
+
+enum class Op {
+  Lda,
+  Ldx,
+  Ldy,
+  Sta,
+  Stx,
+  Sty,
+  Adc,
+  Sbc,
+  And,
+  Ora,
+  Eor,
+  Cmp,
+  Cpx,
+  Cpy,
+  Bit,
+  Asl,
+  Lsr,
+  Rol,
+  Ror,
+  Inc,
+  Dec,
+  Tax,
+  Tay,
+  Txa,
+  Tya,
+  Tsx,
+  Txs,
+  Inx,
+  Iny,
+  Dex,
+  Dey,
+  Clc,
+  Sec,
+  Clv,
+  Cld,
+  Sed,
+  Nop,
+  Pha,
+  Php,
+  Pla,
+  Bpl,
+  Bmi,
+  Bvc,
+  Bvs,
+  Bcc,
+  Bcs,
+  Bne,
+  Beq,
+  Jmp,
+  Jsr,
+  Rts,
+  // anything else ends the block
+  Unsupported,
+};
+
+// named after the Cpu addressing functions they mirror
+enum class Mode {
+  Implied,
+  Accumulator,
+  Immediate,
+  Relative,
+  ZeroPage,
+  ZeroPageX,
+  ZeroPageY,
+  Absolute,
+  AbsoluteX,
+  AbsoluteY,
+  AbsoluteXW,
+  AbsoluteYW,
+  IndirectX,
+  IndirectY,
+  IndirectYW,
+};
+
+struct Instruction {
+  Op op;
+  Mode mode;
+};
+
+Instruction Decode(uint8_t opcode) {
+  switch (opcode) {
+    case 0x01:
+      return {Op::Ora, Mode::IndirectX};
+    case 0x05:
+      return {Op::Ora, Mode::ZeroPage};
+    case 0x06:
+      return {Op::Asl, Mode::ZeroPage};
+    case 0x08:
+      return {Op::Php, Mode::Implied};
+    case 0x09:
+      return {Op::Ora, Mode::Immediate};
+    case 0x0A:
+      return {Op::Asl, Mode::Accumulator};
+    case 0x0D:
+      return {Op::Ora, Mode::Absolute};
+    case 0x0E:
+      return {Op::Asl, Mode::Absolute};
+    case 0x10:
+      return {Op::Bpl, Mode::Relative};
+    case 0x11:
+      return {Op::Ora, Mode::IndirectY};
+    case 0x15:
+      return {Op::Ora, Mode::ZeroPageX};
+    case 0x16:
+      return {Op::Asl, Mode::ZeroPageX};
+    case 0x18:
+      return {Op::Clc, Mode::Implied};
+    case 0x19:
+      return {Op::Ora, Mode::AbsoluteY};
+    case 0x1A:
+      return {Op::Nop, Mode::Implied};
+    case 0x1D:
+      return {Op::Ora, Mode::AbsoluteX};
+    case 0x1E:
+      return {Op::Asl, Mode::AbsoluteXW};
+    case 0x20:
+      return {Op::Jsr, Mode::Absolute};
+    case 0x21:
+      return {Op::And, Mode::IndirectX};
+    case 0x24:
+      return {Op::Bit, Mode::ZeroPage};
+    case 0x25:
+      return {Op::And, Mode::ZeroPage};
+    case 0x26:
+      return {Op::Rol, Mode::ZeroPage};
+    case 0x29:
+      return {Op::And, Mode::Immediate};
+    case 0x2A:
+      return {Op::Rol, Mode::Accumulator};
+    case 0x2C:
+      return {Op::Bit, Mode::Absolute};
+    case 0x2D:
+      return {Op::And, Mode::Absolute};
+    case 0x2E:
+      return {Op::Rol, Mode::Absolute};
+    case 0x30:
+      return {Op::Bmi, Mode::Relative};
+    case 0x31:
+      return {Op::And, Mode::IndirectY};
+    case 0x35:
+      return {Op::And, Mode::ZeroPageX};
+    case 0x36:
+      return {Op::Rol, Mode::ZeroPageX};
+    case 0x38:
+      return {Op::Sec, Mode::Implied};
+    case 0x39:
+      return {Op::And, Mode::AbsoluteY};
+    case 0x3A:
+      return {Op::Nop, Mode::Implied};
+    case 0x3D:
+      return {Op::And, Mode::AbsoluteX};
+    case 0x3E:
+      return {Op::Rol, Mode::AbsoluteXW};
+    case 0x41:
+      return {Op::Eor, Mode::IndirectX};
+    case 0x45:
+      return {Op::Eor, Mode::ZeroPage};
+    case 0x46:
+      return {Op::Lsr, Mode::ZeroPage};
+    case 0x48:
+      return {Op::Pha, Mode::Implied};
+    case 0x49:
+      return {Op::Eor, Mode::Immediate};
+    case 0x4A:
+      return {Op::Lsr, Mode::Accumulator};
+    case 0x4C:
+      return {Op::Jmp, Mode::Absolute};
+    case 0x4D:
+      return {Op::Eor, Mode::Absolute};
+    case 0x4E:
+      return {Op::Lsr, Mode::Absolute};
+    case 0x50:
+      return {Op::Bvc, Mode::Relative};
+    case 0x51:
+      return {Op::Eor, Mode::IndirectY};
+    case 0x55:
+      return {Op::Eor, Mode::ZeroPageX};
+    case 0x56:
+      return {Op::Lsr, Mode::ZeroPageX};
+    case 0x59:
+      return {Op::Eor, Mode::AbsoluteY};
+    case 0x5A:
+      return {Op::Nop, Mode::Implied};
+    case 0x5D:
+      return {Op::Eor, Mode::AbsoluteX};
+    case 0x5E:
+      return {Op::Lsr, Mode::AbsoluteXW};
+    case 0x60:
+      return {Op::Rts, Mode::Implied};
+    case 0x61:
+      return {Op::Adc, Mode::IndirectX};
+    case 0x65:
+      return {Op::Adc, Mode::ZeroPage};
+    case 0x66:
+      return {Op::Ror, Mode::ZeroPage};
+    case 0x68:
+      return {Op::Pla, Mode::Implied};
+    case 0x69:
+      return {Op::Adc, Mode::Immediate};
+    case 0x6A:
+      return {Op::Ror, Mode::Accumulator};
+    case 0x6D:
+      return {Op::Adc, Mode::Absolute};
+    case 0x6E:
+      return {Op::Ror, Mode::Absolute};
+    case 0x70:
+      return {Op::Bvs, Mode::Relative};
+    case 0x71:
+      return {Op::Adc, Mode::IndirectY};
+    case 0x75:
+      return {Op::Adc, Mode::ZeroPageX};
+    case 0x76:
+      return {Op::Ror, Mode::ZeroPageX};
+    case 0x79:
+      return {Op::Adc, Mode::AbsoluteY};
+    case 0x7A:
+      return {Op::Nop, Mode::Implied};
+    case 0x7D:
+      return {Op::Adc, Mode::AbsoluteX};
+    case 0x7E:
+      return {Op::Ror, Mode::AbsoluteXW};
+    case 0x80:
+      return {Op::Nop, Mode::Immediate};
+    case 0x81:
+      return {Op::Sta, Mode::IndirectX};
+    case 0x82:
+      return {Op::Nop, Mode::Immediate};
+    case 0x84:
+      return {Op::Sty, Mode::ZeroPage};
+    case 0x85:
+      return {Op::Sta, Mode::ZeroPage};
+    case 0x86:
+      return {Op::Stx, Mode::ZeroPage};
+    case 0x88:
+      return {Op::Dey, Mode::Implied};
+    case 0x89:
+      return {Op::Nop, Mode::Immediate};
+    case 0x8A:
+      return {Op::Txa, Mode::Implied};
+    case 0x8C:
+      return {Op::Sty, Mode::Absolute};
+    case 0x8D:
+      return {Op::Sta, Mode::Absolute};
+    case 0x8E:
+      return {Op::Stx, Mode::Absolute};
+    case 0x90:
+      return {Op::Bcc, Mode::Relative};
+    case 0x91:
+      return {Op::Sta, Mode::IndirectYW};
+    case 0x94:
+      return {Op::Sty, Mode::ZeroPageX};
+    case 0x95:
+      return {Op::Sta, Mode::ZeroPageX};
+    case 0x96:
+      return {Op::Stx, Mode::ZeroPageY};
+    case 0x98:
+      return {Op::Tya, Mode::Implied};
+    case 0x99:
+      return {Op::Sta, Mode::AbsoluteYW};
+    case 0x9A:
+      return {Op::Txs, Mode::Implied};
+    case 0x9D:
+      return {Op::Sta, Mode::AbsoluteXW};
+    case 0xA0:
+      return {Op::Ldy, Mode::Immediate};
+    case 0xA1:
+      return {Op::Lda, Mode::IndirectX};
+    case 0xA2:
+      return {Op::Ldx, Mode::Immediate};
+    case 0xA4:
+      return {Op::Ldy, Mode::ZeroPage};
+    case 0xA5:
+      return {Op::Lda, Mode::ZeroPage};
+    case 0xA6:
+      return {Op::Ldx, Mode::ZeroPage};
+    case 0xA8:
+      return {Op::Tay, Mode::Implied};
+    case 0xA9:
+      return {Op::Lda, Mode::Immediate};
+    case 0xAA:
+      return {Op::Tax, Mode::Implied};
+    case 0xAC:
+      return {Op::Ldy, Mode::Absolute};
+    case 0xAD:
+      return {Op::Lda, Mode::Absolute};
+    case 0xAE:
+      return {Op::Ldx, Mode::Absolute};
+    case 0xB0:
+      return {Op::Bcs, Mode::Relative};
+    case 0xB1:
+      return {Op::Lda, Mode::IndirectY};
+    case 0xB4:
+      return {Op::Ldy, Mode::ZeroPageX};
+    case 0xB5:
+      return {Op::Lda, Mode::ZeroPageX};
+    case 0xB6:
+      return {Op::Ldx, Mode::ZeroPageY};
+    case 0xB8:
+      return {Op::Clv, Mode::Implied};
+    case 0xB9:
+      return {Op::Lda, Mode::AbsoluteY};
+    case 0xBA:
+      return {Op::Tsx, Mode::Implied};
+    case 0xBC:
+      return {Op::Ldy, Mode::AbsoluteX};
+    case 0xBD:
+      return {Op::Lda, Mode::AbsoluteX};
+    case 0xBE:
+      return {Op::Ldx, Mode::AbsoluteY};
+    case 0xC0:
+      return {Op::Cpy, Mode::Immediate};
+    case 0xC1:
+      return {Op::Cmp, Mode::IndirectX};
+    case 0xC2:
+      return {Op::Nop, Mode::Immediate};
+    case 0xC4:
+      return {Op::Cpy, Mode::ZeroPage};
+    case 0xC5:
+      return {Op::Cmp, Mode::ZeroPage};
+    case 0xC6:
+      return {Op::Dec, Mode::ZeroPage};
+    case 0xC8:
+      return {Op::Iny, Mode::Implied};
+    case 0xC9:
+      return {Op::Cmp, Mode::Immediate};
+    case 0xCA:
+      return {Op::Dex, Mode::Implied};
+    case 0xCC:
+      return {Op::Cpy, Mode::Absolute};
+    case 0xCD:
+      return {Op::Cmp, Mode::Absolute};
+    case 0xCE:
+      return {Op::Dec, Mode::Absolute};
+    case 0xD0:
+      return {Op::Bne, Mode::Relative};
+    case 0xD1:
+      return {Op::Cmp, Mode::IndirectY};
+    case 0xD5:
+      return {Op::Cmp, Mode::ZeroPageX};
+    case 0xD6:
+      return {Op::Dec, Mode::ZeroPageX};
+    case 0xD8:
+      return {Op::Cld, Mode::Implied};
+    case 0xD9:
+      return {Op::Cmp, Mode::AbsoluteY};
+    case 0xDA:
+      return {Op::Nop, Mode::Implied};
+    case 0xDD:
+      return {Op::Cmp, Mode::AbsoluteX};
+    case 0xDE:
+      return {Op::Dec, Mode::AbsoluteXW};
+    case 0xE0:
+      return {Op::Cpx, Mode::Immediate};
+    case 0xE1:
+      return {Op::Sbc, Mode::IndirectX};
+    case 0xE2:
+      return {Op::Nop, Mode::Immediate};
+    case 0xE4:
+      return {Op::Cpx, Mode::ZeroPage};
+    case 0xE5:
+      return {Op::Sbc, Mode::ZeroPage};
+    case 0xE6:
+      return {Op::Inc, Mode::ZeroPage};
+    case 0xE8:
+      return {Op::Inx, Mode::Implied};
+    case 0xE9:
+      return {Op::Sbc, Mode::Immediate};
+    case 0xEA:
+      return {Op::Nop, Mode::Implied};
+    case 0xEB:
+      return {Op::Sbc, Mode::Immediate};
+    case 0xEC:
+      return {Op::Cpx, Mode::Absolute};
+    case 0xED:
+      return {Op::Sbc, Mode::Absolute};
+    case 0xEE:
+      return {Op::Inc, Mode::Absolute};
+    case 0xF0:
+      return {Op::Beq, Mode::Relative};
+    case 0xF1:
+      return {Op::Sbc, Mode::IndirectY};
+    case 0xF5:
+      return {Op::Sbc, Mode::ZeroPageX};
+    case 0xF6:
+      return {Op::Inc, Mode::ZeroPageX};
+    case 0xF8:
+      return {Op::Sed, Mode::Implied};
+    case 0xF9:
+      return {Op::Sbc, Mode::AbsoluteY};
+    case 0xFA:
+      return {Op::Nop, Mode::Implied};
+    case 0xFD:
+      return {Op::Sbc, Mode::AbsoluteX};
+    case 0xFE:
+      return {Op::Inc, Mode::AbsoluteXW};
+    default:
+      return {Op::Unsupported, Mode::Implied};
+  }
+}
+
+int Length(Mode mode) {
+  switch (mode) {
+    case Mode::Implied:
+    case Mode::Accumulator:
+      return 1;
+    case Mode::Absolute:
+    case Mode::AbsoluteX:
+    case Mode::AbsoluteY:
+    case Mode::AbsoluteXW:
+    case Mode::AbsoluteYW:
+      return 3;
+    default:
+      return 2;
+  }
+}
+
+bool IsModify(Op op) {
+  return op == Op::Asl || op == Op::Lsr || op == Op::Rol || op == Op::Ror ||
+         op == Op::Inc || op == Op::Dec;
+}
+
+/*
+  Cycles the interpreter spends on an instruction, leaving out the extra
+  cycles that depend on the address (page crossings, LDA abs,Y).
+*/
+int BaseCycles(Instruction in) {
+  switch (in.op) {
+    case Op::Pha:
+    case Op::Php:
+    case Op::Jmp:
+      return 3;
+    case Op::Pla:
+      return 4;
+    case Op::Jsr:
+    case Op::Rts:
+      return 6;
+    default:
+      break;
+  }
+
+  int extra = IsModify(in.op) ? 2 : 0;
+
+  switch (in.mode) {
+    case Mode::ZeroPage:
+      return 3 + extra;
+    case Mode::ZeroPageX:
+    case Mode::ZeroPageY:
+    case Mode::Absolute:
+    case Mode::AbsoluteX:
+    case Mode::AbsoluteY:
+      return 4 + extra;
+    case Mode::AbsoluteXW:
+    case Mode::AbsoluteYW:
+    case Mode::IndirectY:
+      return 5 + extra;
+    case Mode::IndirectX:
+    case Mode::IndirectYW:
+      return 6 + extra;
+    default:
+      return 2;
+  }
+}
+
+/* Register roles in compiled code (System V calling convention) */
+constexpr Reg STATE = Reg::Rdi;
+constexpr Reg RAM = Reg::Rsi;
+constexpr Reg BOUNDARIES = Reg::R8;
+constexpr Reg COUNT = Reg::R9;
+constexpr Reg CYCLES = Reg::R10;
+constexpr Reg UNDO = Reg::R11;
+
+constexpr int32_t STATE_A = offsetof(JitState, A);
+constexpr int32_t STATE_X = offsetof(JitState, X);
+constexpr int32_t STATE_Y = offsetof(JitState, Y);
+constexpr int32_t STATE_SP = offsetof(JitState, SP);
+constexpr int32_t STATE_N = offsetof(JitState, flag_N);
+constexpr int32_t STATE_V = offsetof(JitState, flag_V);
+constexpr int32_t STATE_D = offsetof(JitState, flag_D);
+constexpr int32_t STATE_I = offsetof(JitState, flag_I);
+constexpr int32_t STATE_Z = offsetof(JitState, flag_Z);
+constexpr int32_t STATE_C = offsetof(JitState, flag_C);
+constexpr int32_t STATE_PC = offsetof(JitState, PC);
+constexpr int32_t STATE_LIMIT = offsetof(JitState, limit);
+constexpr int32_t STATE_INSTRUCTIONS = offsetof(JitState, instructions);
+constexpr int32_t STATE_CYCLE_BUDGET = offsetof(JitState, cycle_budget);
+constexpr int32_t STATE_CYCLES = offsetof(JitState, cycles);
+constexpr int32_t STATE_RAM = offsetof(JitState, ram);
+constexpr int32_t STATE_BOUNDARIES = offsetof(JitState, boundaries);
+constexpr int32_t STATE_UNDO = offsetof(JitState, undo);
+
+class BlockCompiler {
+ public:
+  BlockCompiler(mappers::Mapper& cartridge, uint16_t start)
+      : cartridge(cartridge), start(start) {}
+
+  // False if not even the first instruction can be compiled.
+  bool Compile();
+  std::vector<uint8_t>& Code() { return e.Finish(); }
+  // bytes of PRG-ROM the compiled instructions take up
+  uint16_t SourceLength() { return end - start; }
+
+ private:
+  bool Supported(Instruction in, uint16_t operand);
+  bool Emit(uint16_t pc, Instruction in, uint16_t operand);
+
+  void Address(uint16_t pc, Instruction in, uint16_t operand);
+  void ReadOp(Op op);
+  void ModifyOp(Op op);
+  void StoreLogged();
+  void Push();
+  void UpdateNZ();
+  void AddCycleIfAtLeast(uint32_t bound);
+  void Account(int cycles);
+  void Jump(uint16_t target);
+  Label Exit(uint16_t pc);
+
+  mappers::Mapper& cartridge;
+  uint16_t start;
+  uint16_t end;
+  X64Emitter e;
+  Label loop;
+  Label common_exit;
+  std::map<uint16_t, Label> exits;
+};
+
+bool BlockCompiler::Compile() {
+  loop = e.NewLabel();
+  common_exit = e.NewLabel();
+
+  e.Load64(RAM, STATE, STATE_RAM);
+  e.Load64(BOUNDARIES, STATE, STATE_BOUNDARIES);
+  e.Load64(UNDO, STATE, STATE_UNDO);
+  e.Alu32(Alu::Xor, COUNT, COUNT);
+  e.Alu32(Alu::Xor, CYCLES, CYCLES);
+  e.Bind(loop);
+
+  uint16_t pc = start;
+  bool ended = false;
+
+  for (int n = 0; n < JIT_MAX_BLOCK_LENGTH && !ended; n++) {
+    Instruction in = Decode(cartridge.CpuRead(pc));
+    int length = Length(in.mode);
+    uint16_t last = pc + length - 1;
+    uint16_t operand = 0;
+
+    if (length > 1) {
+      operand = cartridge.CpuRead(pc + 1);
+    }
+    if (length > 2) {
+      operand |= static_cast<uint16_t>(cartridge.CpuRead(pc + 2)) << 8;
+    }
+
+    // the whole block has to come from the bank mapped at start
+    bool same_slot = pc >= 0x8000 && (pc & 0xF000) == (start & 0xF000) &&
+                     (last & 0xF000) == (start & 0xF000);
+    // and CpuRead doesn't see cheats, so code they patch is interpreted
+    bool cheated = false;
+    for (int i = 0; i < length; i++) {
+      cheated |= cartridge.MayBeCheated(pc + i);
+    }
+
+    if (!same_slot || cheated || !Supported(in, operand)) {
+      if (n == 0) {
+        return false;
+      }
+      break;
+    }
+
+    e.Alu32Mem(Alu::Cmp, COUNT, STATE, STATE_LIMIT);
+    e.Jcc(Cond::AE, Exit(pc));
+
+    ended = Emit(pc, in, operand);
+    pc += length;
+  }
+
+  end = pc;
+
+  if (!ended) {
+    e.Jmp(Exit(pc));
+  }
+
+  for (auto& [exit_pc, label] : exits) {
+    e.Bind(label);
+    e.Store16Imm(STATE, STATE_PC, exit_pc);
+    e.Jmp(common_exit);
+  }
+
+  e.Bind(common_exit);
+  e.Store32(STATE, STATE_INSTRUCTIONS, COUNT);
+  e.Store32(STATE, STATE_CYCLES, CYCLES);
+  e.Store64(STATE, STATE_UNDO, UNDO);
+  e.Ret();
+  return true;
+}
+
+bool BlockCompiler::Supported(Instruction in, uint16_t operand) {
+  if (in.op == Op::Unsupported) {
+    return false;
+  }
+
+  switch (in.mode) {
+    case Mode::Absolute:
+      // fixed addresses outside internal RAM may be registers
+      return in.op == Op::Jmp || in.op == Op::Jsr || operand < 0x2000;
+    case Mode::AbsoluteX:
+    case Mode::AbsoluteY:
+    case Mode::AbsoluteXW:
+    case Mode::AbsoluteYW:
+      // the dummy read stays in the base address' page
+      return operand < 0x2000;
+    default:
+      return true;
+  }
+}
+
+/*
+  Emits one instruction. Returns true if it ends the block.
+*/
+bool BlockCompiler::Emit(uint16_t pc, Instruction in, uint16_t operand) {
+  int cycles = BaseCycles(in);
+
+  switch (in.op) {
+    case Op::Bpl:
+    case Op::Bmi:
+    case Op::Bvc:
+    case Op::Bvs:
+    case Op::Bcc:
+    case Op::Bcs:
+    case Op::Bne:
+    case Op::Beq: {
+      int32_t flag = STATE_N;
+      bool when_set = false;
+      switch (in.op) {
+        case Op::Bpl:
+          flag = STATE_N;
+          break;
+        case Op::Bmi:
+          flag = STATE_N;
+          when_set = true;
+          break;
+        case Op::Bvc:
+          flag = STATE_V;
+          break;
+        case Op::Bvs:
+          flag = STATE_V;
+          when_set = true;
+          break;
+        case Op::Bcc:
+          flag = STATE_C;
+          break;
+        case Op::Bcs:
+          flag = STATE_C;
+          when_set = true;
+          break;
+        case Op::Bne:
+          flag = STATE_Z;
+          break;
+        default:
+          flag = STATE_Z;
+          when_set = true;
+          break;
+      }
+      uint16_t next = pc + 2;
+      uint16_t target = next + static_cast<int8_t>(operand & 0xFF);
+      Label taken = e.NewLabel();
+      Account(cycles);
+      e.Movzx8(Reg::Rax, STATE, flag);
+      e.Test8(Reg::Rax, Reg::Rax);
+      e.Jcc(when_set ? Cond::NZ : Cond::Z, taken);
+      e.Jmp(Exit(next));
+      e.Bind(taken);
+      Jump(target);
+      return true;
+    }
+    case Op::Jmp:
+      Account(cycles);
+      Jump(operand);
+      return true;
+    case Op::Jsr: {
+      uint16_t ret = pc + 2;
+      e.MovImm32(Reg::Rax, ret >> 8);
+      Push();
+      e.MovImm32(Reg::Rax, ret & 0xFF);
+      Push();
+      Account(cycles);
+      e.Jmp(Exit(operand));
+      return true;
+    }
+    case Op::Rts:
+      e.Inc8Mem(STATE, STATE_SP);
+      e.Movzx8(Reg::Rcx, STATE, STATE_SP);
+      e.Alu32Imm(Alu::Or, Reg::Rcx, 0x100);
+      e.Movzx8Indexed(Reg::Rax, RAM, Reg::Rcx);
+      e.Inc8Mem(STATE, STATE_SP);
+      e.Movzx8(Reg::Rcx, STATE, STATE_SP);
+      e.Alu32Imm(Alu::Or, Reg::Rcx, 0x100);
+      e.Movzx8Indexed(Reg::Rcx, RAM, Reg::Rcx);
+      e.Shl32(Reg::Rcx, 8);
+      e.Alu32(Alu::Or, Reg::Rcx, Reg::Rax);
+      e.Inc32(Reg::Rcx);
+      e.Store16(STATE, STATE_PC, Reg::Rcx);
+      Account(cycles);
+      e.Jmp(common_exit);
+      return true;
+    default:
+      break;
+  }
+
+  switch (in.mode) {
+    case Mode::Implied:
+      switch (in.op) {
+        case Op::Tax:
+        case Op::Tay:
+        case Op::Txa:
+        case Op::Tya:
+        case Op::Tsx:
+        case Op::Txs: {
+          int32_t from = in.op == Op::Tax || in.op == Op::Tay ? STATE_A
+                         : in.op == Op::Txa || in.op == Op::Txs ? STATE_X
+                         : in.op == Op::Tya                     ? STATE_Y
+                                                                : STATE_SP;
+          int32_t to = in.op == Op::Txa || in.op == Op::Tya ? STATE_A
+                       : in.op == Op::Tax || in.op == Op::Tsx ? STATE_X
+                       : in.op == Op::Tay                     ? STATE_Y
+                                                              : STATE_SP;
+          e.Movzx8(Reg::Rax, STATE, from);
+          e.Store8(STATE, to, Reg::Rax);
+          if (in.op != Op::Txs) {
+            e.Test8(Reg::Rax, Reg::Rax);
+            UpdateNZ();
+          }
+          break;
+        }
+        case Op::Inx:
+          e.Inc8Mem(STATE, STATE_X);
+          UpdateNZ();
+          break;
+        case Op::Iny:
+          e.Inc8Mem(STATE, STATE_Y);
+          UpdateNZ();
+          break;
+        case Op::Dex:
+          e.Dec8Mem(STATE, STATE_X);
+          UpdateNZ();
+          break;
+        case Op::Dey:
+          e.Dec8Mem(STATE, STATE_Y);
+          UpdateNZ();
+          break;
+        case Op::Clc:
+          e.Store8Imm(STATE, STATE_C, 0);
+          break;
+        case Op::Sec:
+          e.Store8Imm(STATE, STATE_C, 1);
+          break;
+        case Op::Clv:
+          e.Store8Imm(STATE, STATE_V, 0);
+          break;
+        case Op::Cld:
+          e.Store8Imm(STATE, STATE_D, 0);
+          break;
+        case Op::Sed:
+          e.Store8Imm(STATE, STATE_D, 1);
+          break;
+        case Op::Pha:
+          e.Movzx8(Reg::Rax, STATE, STATE_A);
+          Push();
+          break;
+        case Op::Php: {
+          constexpr std::array<std::pair<int32_t, uint8_t>, 6> FLAGS = {{
+              {STATE_N, 7},
+              {STATE_V, 6},
+              {STATE_D, 3},
+              {STATE_I, 2},
+              {STATE_Z, 1},
+              {STATE_C, 0},
+          }};
+          e.MovImm32(Reg::Rax, 0x30);
+          for (auto& [flag, bit] : FLAGS) {
+            e.Movzx8(Reg::Rdx, STATE, flag);
+            if (bit > 0) {
+              e.Shl32(Reg::Rdx, bit);
+            }
+            e.Alu32(Alu::Or, Reg::Rax, Reg::Rdx);
+          }
+          Push();
+          break;
+        }
+        case Op::Pla:
+          e.Inc8Mem(STATE, STATE_SP);
+          e.Movzx8(Reg::Rcx, STATE, STATE_SP);
+          e.Alu32Imm(Alu::Or, Reg::Rcx, 0x100);
+          e.Movzx8Indexed(Reg::Rdx, RAM, Reg::Rcx);
+          ReadOp(Op::Lda);
+          break;
+        default:
+          // NOP
+          break;
+      }
+      break;
+    case Mode::Accumulator:
+      e.Movzx8(Reg::Rax, STATE, STATE_A);
+      ModifyOp(in.op);
+      e.Store8(STATE, STATE_A, Reg::Rax);
+      break;
+    case Mode::Immediate:
+      if (in.op != Op::Nop) {
+        e.MovImm32(Reg::Rdx, operand);
+        ReadOp(in.op);
+      }
+      break;
+    default:
+      // everything with a memory operand; the address ends up in ecx
+      Address(pc, in, operand);
+      if (in.op == Op::Sta || in.op == Op::Stx || in.op == Op::Sty) {
+        e.Movzx8(Reg::Rax, STATE,
+                 in.op == Op::Sta   ? STATE_A
+                 : in.op == Op::Stx ? STATE_X
+                                    : STATE_Y);
+        StoreLogged();
+      } else if (IsModify(in.op)) {
+        e.Movzx8Indexed(Reg::Rax, RAM, Reg::Rcx);
+        ModifyOp(in.op);
+        StoreLogged();
+      } else {
+        e.Movzx8Indexed(Reg::Rdx, RAM, Reg::Rcx);
+        ReadOp(in.op);
+      }
+      break;
+  }
+
+  Account(cycles);
+  return false;
+}
+
+/*
+  Leaves the internal RAM index of the operand in ecx. Addresses only known
+  at run time are checked here, and the block exits before the instruction if
+  they fall outside internal RAM.
+*/
+void BlockCompiler::Address(uint16_t pc, Instruction in, uint16_t operand) {
+  switch (in.mode) {
+    case Mode::ZeroPage:
+      e.MovImm32(Reg::Rcx, operand);
+      return;
+    case Mode::ZeroPageX:
+    case Mode::ZeroPageY:
+      e.Movzx8(Reg::Rcx, STATE,
+               in.mode == Mode::ZeroPageX ? STATE_X : STATE_Y);
+      e.Alu8Imm(Alu::Add, Reg::Rcx, static_cast<uint8_t>(operand));
+      e.Movzx8Reg(Reg::Rcx, Reg::Rcx);
+      return;
+    case Mode::Absolute:
+      e.MovImm32(Reg::Rcx, operand & 0x7FF);
+      return;
+    case Mode::AbsoluteX:
+    case Mode::AbsoluteY:
+    case Mode::AbsoluteXW:
+    case Mode::AbsoluteYW: {
+      bool x = in.mode == Mode::AbsoluteX || in.mode == Mode::AbsoluteXW;
+      e.Movzx8(Reg::Rcx, STATE, x ? STATE_X : STATE_Y);
+      e.Alu32Imm(Alu::Add, Reg::Rcx, operand);
+      e.Alu32Imm(Alu::Cmp, Reg::Rcx, 0x2000);
+      e.Jcc(Cond::AE, Exit(pc));
+      if (in.mode == Mode::AbsoluteX || in.mode == Mode::AbsoluteY) {
+        // page crossed
+        AddCycleIfAtLeast((operand & 0xFF00) + 0x100);
+      }
+      if (in.op == Op::Lda && in.mode == Mode::AbsoluteY) {
+        AddCycleIfAtLeast(0x100);
+      }
+      e.Alu32Imm(Alu::And, Reg::Rcx, 0x7FF);
+      return;
+    }
+    case Mode::IndirectX:
+      e.Movzx8(Reg::Rcx, STATE, STATE_X);
+      e.Alu8Imm(Alu::Add, Reg::Rcx, static_cast<uint8_t>(operand));
+      e.Movzx8Reg(Reg::Rcx, Reg::Rcx);
+      e.Movzx8Indexed(Reg::Rax, RAM, Reg::Rcx);
+      e.Inc8(Reg::Rcx);
+      e.Movzx8Reg(Reg::Rcx, Reg::Rcx);
+      e.Movzx8Indexed(Reg::Rcx, RAM, Reg::Rcx);
+      e.Shl32(Reg::Rcx, 8);
+      e.Alu32(Alu::Or, Reg::Rcx, Reg::Rax);
+      e.Alu32Imm(Alu::Cmp, Reg::Rcx, 0x2000);
+      e.Jcc(Cond::AE, Exit(pc));
+      e.Alu32Imm(Alu::And, Reg::Rcx, 0x7FF);
+      return;
+    default: {
+      // IndirectY, IndirectYW
+      e.Movzx8(Reg::Rcx, RAM, operand & 0xFF);
+      e.Movzx8(Reg::Rax, RAM, (operand + 1) & 0xFF);
+      e.Shl32(Reg::Rax, 8);
+      e.Alu32(Alu::Or, Reg::Rcx, Reg::Rax);
+      e.Mov32(Reg::Rdx, Reg::Rcx);
+      e.Movzx8(Reg::Rax, STATE, STATE_Y);
+      // not wrapped to 16 bits, so that wrapping around 0xFFFF exits too
+      e.Alu32(Alu::Add, Reg::Rcx, Reg::Rax);
+      e.Alu32Imm(Alu::Cmp, Reg::Rcx, 0x2000);
+      e.Jcc(Cond::AE, Exit(pc));
+      if (in.mode == Mode::IndirectY) {
+        Label same_page = e.NewLabel();
+        e.Mov32(Reg::Rax, Reg::Rcx);
+        e.Alu32(Alu::Xor, Reg::Rax, Reg::Rdx);
+        e.Test32Imm(Reg::Rax, 0xFF00);
+        e.Jcc(Cond::Z, same_page);
+        e.Inc32(CYCLES);
+        e.Bind(same_page);
+      }
+      e.Alu32Imm(Alu::And, Reg::Rcx, 0x7FF);
+      return;
+    }
+  }
+}
+
+/* Operand in dl */
+void BlockCompiler::ReadOp(Op op) {
+  switch (op) {
+    case Op::Lda:
+    case Op::Ldx:
+    case Op::Ldy:
+      e.Store8(STATE,
+               op == Op::Lda   ? STATE_A
+               : op == Op::Ldx ? STATE_X
+                               : STATE_Y,
+               Reg::Rdx);
+      e.Test8(Reg::Rdx, Reg::Rdx);
+      UpdateNZ();
+      return;
+    case Op::And:
+    case Op::Ora:
+    case Op::Eor:
+      e.Movzx8(Reg::Rax, STATE, STATE_A);
+      e.Alu8(op == Op::And   ? Alu::And
+             : op == Op::Ora ? Alu::Or
+                             : Alu::Xor,
+             Reg::Rax, Reg::Rdx);
+      UpdateNZ();
+      e.Store8(STATE, STATE_A, Reg::Rax);
+      return;
+    case Op::Adc:
+    case Op::Sbc:
+      if (op == Op::Sbc) {
+        e.Alu8Imm(Alu::Xor, Reg::Rdx, 0xFF);
+      }
+      e.Movzx8(Reg::Rax, STATE, STATE_A);
+      e.Movzx8(Reg::Rcx, STATE, STATE_C);
+      // carry flag = flag_C
+      e.Alu8Imm(Alu::Add, Reg::Rcx, 0xFF);
+      e.Alu8(Alu::Adc, Reg::Rax, Reg::Rdx);
+      e.Setcc(Cond::B, STATE, STATE_C);
+      e.Setcc(Cond::O, STATE, STATE_V);
+      UpdateNZ();
+      e.Store8(STATE, STATE_A, Reg::Rax);
+      return;
+    case Op::Cmp:
+    case Op::Cpx:
+    case Op::Cpy:
+      e.Movzx8(Reg::Rax, STATE,
+               op == Op::Cmp   ? STATE_A
+               : op == Op::Cpx ? STATE_X
+                               : STATE_Y);
+      e.Alu8(Alu::Cmp, Reg::Rax, Reg::Rdx);
+      e.Setcc(Cond::AE, STATE, STATE_C);
+      UpdateNZ();
+      return;
+    default:
+      // BIT
+      e.Movzx8(Reg::Rax, STATE, STATE_A);
+      e.Test8(Reg::Rax, Reg::Rdx);
+      e.Setcc(Cond::Z, STATE, STATE_Z);
+      e.Mov32(Reg::Rax, Reg::Rdx);
+      e.Shr32(Reg::Rax, 7);
+      e.Store8(STATE, STATE_N, Reg::Rax);
+      e.Mov32(Reg::Rax, Reg::Rdx);
+      e.Shr32(Reg::Rax, 6);
+      e.Alu32Imm(Alu::And, Reg::Rax, 1);
+      e.Store8(STATE, STATE_V, Reg::Rax);
+      return;
+  }
+}
+
+/* Value in al */
+void BlockCompiler::ModifyOp(Op op) {
+  switch (op) {
+    case Op::Asl:
+    case Op::Lsr:
+      e.Shift8(op == Op::Asl ? Shift::Shl : Shift::Shr, Reg::Rax);
+      e.Setcc(Cond::B, STATE, STATE_C);
+      UpdateNZ();
+      return;
+    case Op::Rol:
+    case Op::Ror:
+      // carry flag = flag_C
+      e.Movzx8(Reg::Rdx, STATE, STATE_C);
+      e.Shift8(Shift::Shr, Reg::Rdx);
+      e.Shift8(op == Op::Rol ? Shift::Rcl : Shift::Rcr, Reg::Rax);
+      e.Setcc(Cond::B, STATE, STATE_C);
+      e.Test8(Reg::Rax, Reg::Rax);
+      UpdateNZ();
+      return;
+    case Op::Inc:
+      e.Inc8(Reg::Rax);
+      UpdateNZ();
+      return;
+    default:
+      e.Dec8(Reg::Rax);
+      UpdateNZ();
+      return;
+  }
+}
+
+/* Writes al to RAM index ecx, logging the old value */
+void BlockCompiler::StoreLogged() {
+  e.Movzx8Indexed(Reg::Rdx, RAM, Reg::Rcx);
+  e.Shl32(Reg::Rdx, 16);
+  e.Alu32(Alu::Or, Reg::Rdx, Reg::Rcx);
+  e.Store32(UNDO, 0, Reg::Rdx);
+  e.Alu64Imm(Alu::Add, UNDO, 4);
+  e.Store8Indexed(RAM, Reg::Rcx, Reg::Rax);
+}
+
+/* Pushes al */
+void BlockCompiler::Push() {
+  e.Movzx8(Reg::Rcx, STATE, STATE_SP);
+  e.Alu32Imm(Alu::Or, Reg::Rcx, 0x100);
+  StoreLogged();
+  e.Dec8Mem(STATE, STATE_SP);
+}
+
+/* From the sign and zero flags of the last result */
+void BlockCompiler::UpdateNZ() {
+  e.Setcc(Cond::S, STATE, STATE_N);
+  e.Setcc(Cond::Z, STATE, STATE_Z);
+}
+
+/* One more cycle if ecx >= bound */
+void BlockCompiler::AddCycleIfAtLeast(uint32_t bound) {
+  Label below = e.NewLabel();
+  e.Alu32Imm(Alu::Cmp, Reg::Rcx, bound);
+  e.Jcc(Cond::B, below);
+  e.Inc32(CYCLES);
+  e.Bind(below);
+}
+
+/* Ends an instruction */
+void BlockCompiler::Account(int cycles) {
+  e.Alu32Imm(Alu::Add, CYCLES, cycles);
+  e.Store32Indexed(BOUNDARIES, COUNT, 4, CYCLES);
+  e.Inc32(COUNT);
+}
+
+/* Jumps back to the top of the block while the budget lasts */
+void BlockCompiler::Jump(uint16_t target) {
+  if (target == start) {
+    e.Alu32Mem(Alu::Cmp, CYCLES, STATE, STATE_CYCLE_BUDGET);
+    e.Jcc(Cond::B, loop);
+  }
+
+  e.Jmp(Exit(target));
+}
+
+Label BlockCompiler::Exit(uint16_t pc) {
+  auto it = exits.find(pc);
+
+  if (it != exits.end()) {
+    return it->second;
+  }
+
+  Label label = e.NewLabel();
+  exits.emplace(pc, label);
+  return label;
+}
+
+}  // namespace
+
+/*=================================================================
+*  Jit
+=================================================================*/
+Jit::Jit(std::shared_ptr<mappers::Mapper> mapper, uint8_t* ram)
+    : boundaries(),
+      cartridge(mapper),
+      ram(ram),
+      rom(mapper),
+      block_index(rom.Size() + PRG_SLOT_SIZE, NO_BLOCK),
+      heat(rom.Size() + PRG_SLOT_SIZE, 0),
+      undo_log() {
+#if defined(NESEMU_JIT_SUPPORTED)
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(__APPLE__)
+  // a hardened runtime only lets MAP_JIT memory become executable, and
+  // then only with the allow-jit entitlement
+  flags |= MAP_JIT;
+#endif
+
+  // writable until code is copied in, see Compile
+  void* buffer =
+      mmap(nullptr, JIT_CODE_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+  if (buffer == MAP_FAILED) {
+    throw "Failed to allocate JIT code buffer";
+  }
+
+  code_buffer = static_cast<uint8_t*>(buffer);
+#else
+  throw "The JIT is only available on x86-64";
+#endif
+}
+
+Jit::~Jit() {
+#if defined(NESEMU_JIT_SUPPORTED)
+  if (code_buffer != nullptr) {
+    munmap(code_buffer, JIT_CODE_SIZE);
+  }
+#endif
+}
+
+const JitBlock* Jit::Find(uint16_t addr) {
+  if (addr < 0x8000) {
+    return nullptr;
+  }
+
+  rom.TakeRomWrites(
+      [this](uint64_t begin, uint64_t end) { Drop(begin, end); });
+
+  uint64_t offset = rom.Offset(addr);
+
+  if (offset >= rom.Size()) {
+    return nullptr;
+  }
+
+  int32_t index = block_index[offset];
+
+  if (index >= 0) {
+    // the same bank can be mapped at more than one address
+    return blocks[index].addr == addr ? &blocks[index] : nullptr;
+  }
+
+  if (index == NOT_COMPILABLE || ++heat[offset] < JIT_HOT_THRESHOLD) {
+    return nullptr;
+  }
+
+  if (!Compile(addr, offset)) {
+    block_index[offset] = NOT_COMPILABLE;
+    return nullptr;
+  }
+
+  return &blocks[block_index[offset]];
+}
+
+void Jit::Run(const JitBlock& block, JitState& state) {
+  state.ram = ram;
+  state.boundaries = boundaries.data();
+  state.undo = undo_log.data();
+  block.code(&state);
+}
+
+void Jit::Undo(const JitState& state) {
+  for (uint32_t* entry = state.undo; entry != undo_log.data();) {
+    entry--;
+    ram[*entry & 0xFFFF] = static_cast<uint8_t>(*entry >> 16);
+  }
+}
+
+bool Jit::Compile(uint16_t addr, uint64_t offset) {
+  BlockCompiler compiler(*cartridge, addr);
+
+  if (!compiler.Compile()) {
+    return false;
+  }
+
+  std::vector<uint8_t>& code = compiler.Code();
+
+  if (code_used + code.size() > JIT_CODE_SIZE) {
+    Reset();
+  }
+
+  // Code pages are never writable and executable at once: the pages the
+  // block goes into (which may hold the end of the previous block) are
+  // made writable for the copy, then executable again.
+  Protect(code_used, code_used + code.size(), false);
+  std::memcpy(code_buffer + code_used, code.data(), code.size());
+  Protect(code_used, code_used + code.size(), true);
+  blocks.push_back(JitBlock{
+      addr, compiler.SourceLength(),
+      reinterpret_cast<void (*)(JitState*)>(code_buffer + code_used)});
+  block_index[offset] = static_cast<int32_t>(blocks.size() - 1);
+  code_used += code.size();
+  blocks_compiled++;
+  return true;
+}
+
+void Jit::Protect(uint64_t begin, uint64_t end, bool executable) {
+#if defined(NESEMU_JIT_SUPPORTED)
+  uint64_t page = sysconf(_SC_PAGESIZE);
+  begin -= begin % page;
+  end = (end + page - 1) / page * page;
+  int protection = PROT_READ | (executable ? PROT_EXEC : PROT_WRITE);
+
+  if (mprotect(code_buffer + begin, end - begin, protection) != 0) {
+    throw "Failed to change JIT code buffer protection";
+  }
+#endif
+}
+
+void Jit::Drop(uint64_t begin, uint64_t end) {
+  if (begin == 0 && end >= block_index.size()) {
+    Reset();
+    return;
+  }
+
+  // blocks starting this far back can reach begin
+  uint64_t first = begin < 3 * JIT_MAX_BLOCK_LENGTH
+                       ? 0
+                       : begin - 3 * JIT_MAX_BLOCK_LENGTH;
+
+  for (uint64_t offset = first; offset < end; offset++) {
+    int32_t index = block_index[offset];
+
+    // NOT_COMPILABLE only depends on the first instruction
+    if (index >= 0 ? offset + blocks[index].length > begin
+                   : index == NOT_COMPILABLE && offset + 3 > begin) {
+      // has to get hot again before it is compiled from the new code
+      block_index[offset] = NO_BLOCK;
+      heat[offset] = 0;
+    }
+  }
+
+  std::fill(heat.begin() + begin, heat.begin() + end, 0);
+}
+
+void Jit::Reset() {
+  std::fill(block_index.begin(), block_index.end(), NO_BLOCK);
+  std::fill(heat.begin(), heat.end(), 0);
+  blocks.clear();
+  code_used = 0;
+}
+
+}  // namespace cpu
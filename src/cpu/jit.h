@@ -0,0 +1,113 @@
+#ifndef SRC_CPU_JIT_H_
+#define SRC_CPU_JIT_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "src/cpu/prg_rom_map.h"
+#include "src/mappers/mapper.h"
+
+namespace cpu {
+
+enum class JitMode {
+  Off,
+  On,
+  // run every compiled block through the interpreter as well and throw if
+  // the two disagree
+  Check,
+};
+
+// instructions a compiled block may execute per call
+constexpr int JIT_MAX_INSTRUCTIONS = 1024;
+// instructions compiled into one block
+constexpr int JIT_MAX_BLOCK_LENGTH = 64;
+// executions of an address in PRG-ROM before a block is compiled there
+constexpr int JIT_HOT_THRESHOLD = 32;
+constexpr uint64_t JIT_CODE_SIZE = 4 * 1024 * 1024;
+
+/*
+  Everything compiled code reads and writes. Flags are 0 or 1.
+*/
+struct JitState {
+  uint8_t A;
+  uint8_t X;
+  uint8_t Y;
+  uint8_t SP;
+  uint8_t flag_N;
+  uint8_t flag_V;
+  uint8_t flag_D;
+  uint8_t flag_I;
+  uint8_t flag_Z;
+  uint8_t flag_C;
+  uint16_t PC;
+  // in: most instructions to execute, out: instructions executed
+  uint32_t limit;
+  uint32_t instructions;
+  // loops in a block stop going round once this many cycles are used
+  uint32_t cycle_budget;
+  uint32_t cycles;
+  uint8_t* ram;
+  // cycles used up to the end of each executed instruction
+  uint32_t* boundaries;
+  // one entry per RAM write, (old value << 16) | address
+  uint32_t* undo;
+};
+
+struct JitBlock {
+  uint16_t addr;
+  // bytes of PRG-ROM the block was compiled from, from the offset it is
+  // indexed by
+  uint16_t length;
+  void (*code)(JitState*);
+};
+
+/*
+  Compiles hot straight-line code in PRG-ROM to x86-64. A block only touches
+  registers and internal RAM and does no timing of its own: it reports how
+  many cycles each instruction took, and the caller charges them to the PPU
+  and APU afterwards. Anything that could reach PPU, APU or mapper registers
+  ends the block, either when compiling (fixed addresses) or at run time
+  (indexed and indirect addresses), before the instruction has any effect.
+  A write to PRG-ROM only drops the blocks compiled from the written bytes.
+*/
+class Jit {
+ public:
+  Jit(std::shared_ptr<mappers::Mapper> mapper, uint8_t* ram);
+  ~Jit();
+
+  // Block compiled for addr, compiling one once addr gets hot.
+  const JitBlock* Find(uint16_t addr);
+  void Run(const JitBlock& block, JitState& state);
+  // Reverts the RAM writes of the last Run.
+  void Undo(const JitState& state);
+
+  std::array<uint32_t, JIT_MAX_INSTRUCTIONS> boundaries;
+  uint64_t blocks_compiled = 0;
+
+ private:
+  bool Compile(uint16_t addr, uint64_t offset);
+  // Makes the pages of code_buffer holding [begin, end) executable, or
+  // writable otherwise.
+  void Protect(uint64_t begin, uint64_t end, bool executable);
+  // Drops what was derived from PRG-ROM offsets [begin, end): the blocks
+  // compiled from them, and their heat and NOT_COMPILABLE markers.
+  void Drop(uint64_t begin, uint64_t end);
+  void Reset();
+
+  std::shared_ptr<mappers::Mapper> cartridge;
+  uint8_t* ram;
+  PrgRomMap rom;
+  // per PRG-ROM offset: index into blocks, or one of the markers in jit.cc
+  std::vector<int32_t> block_index;
+  std::vector<uint8_t> heat;
+  std::vector<JitBlock> blocks;
+  std::array<uint32_t, 2 * JIT_MAX_INSTRUCTIONS> undo_log;
+  uint8_t* code_buffer = nullptr;
+  uint64_t code_used = 0;
+};
+
+}  // namespace cpu
+
+#endif  // SRC_CPU_JIT_H_
@@ -0,0 +1,331 @@
+#ifndef SRC_CPU_OPCODES_H_
+#define SRC_CPU_OPCODES_H_
+
+/*
+  Opcode dispatch backends, selected at build time:
+
+    NESEMU_DISPATCH_SWITCH         switch statement over the opcode
+    NESEMU_DISPATCH_TABLE          dense table of handler pointers (default)
+    NESEMU_DISPATCH_COMPUTED_GOTO  threaded dispatch using labels as values
+                                   (GCC and Clang only)
+*/
+#if defined(NESEMU_DISPATCH_COMPUTED_GOTO)
+#if !defined(__GNUC__)
+#error "NESEMU_DISPATCH_COMPUTED_GOTO requires GCC or Clang"
+#endif
+#elif !defined(NESEMU_DISPATCH_SWITCH) && !defined(NESEMU_DISPATCH_TABLE)
+#define NESEMU_DISPATCH_TABLE
+#endif
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace cpu {
+
+#if defined(NESEMU_DISPATCH_SWITCH)
+constexpr const char* DISPATCH_BACKEND = "switch";
+#elif defined(NESEMU_DISPATCH_COMPUTED_GOTO)
+constexpr const char* DISPATCH_BACKEND = "computed-goto";
+#else
+constexpr const char* DISPATCH_BACKEND = "table";
+#endif
+
+}  // namespace cpu
+
+// X(opcode, handler...) for every one of the 256 opcodes, in opcode order.
+// The handler is variadic because template argument lists contain commas.
+#define CPU_OPCODES(X)                         \
+  X(0x00, BrkImplied)                          \
+  X(0x01, Read<&Cpu::Ora, &Cpu::IndirectX>)    \
+  X(0x02, Stp)                                 \
+  X(0x03, Modify<&Cpu::Slo, &Cpu::IndirectX>)  \
+  X(0x04, Nop<&Cpu::ZeroPage>)                 \
+  X(0x05, Read<&Cpu::Ora, &Cpu::ZeroPage>)     \
+  X(0x06, Modify<&Cpu::Asl, &Cpu::ZeroPage>)   \
+  X(0x07, Modify<&Cpu::Slo, &Cpu::ZeroPage>)   \
+  X(0x08, PhpImplied)                          \
+  X(0x09, Immediate<&Cpu::Ora>)                \
+  X(0x0A, Accumulator<&Cpu::Asl>)              \
+  X(0x0B, Immediate<&Cpu::Anc>)                \
+  X(0x0C, Nop<&Cpu::Absolute>)                 \
+  X(0x0D, Read<&Cpu::Ora, &Cpu::Absolute>)     \
+  X(0x0E, Modify<&Cpu::Asl, &Cpu::Absolute>)   \
+  X(0x0F, Modify<&Cpu::Slo, &Cpu::Absolute>)   \
+  X(0x10, BplRelative)                         \
+  X(0x11, Read<&Cpu::Ora, &Cpu::IndirectY>)    \
+  X(0x12, Stp)                                 \
+  X(0x13, Modify<&Cpu::Slo, &Cpu::IndirectYW>) \
+  X(0x14, Nop<&Cpu::ZeroPageX>)                \
+  X(0x15, Read<&Cpu::Ora, &Cpu::ZeroPageX>)    \
+  X(0x16, Modify<&Cpu::Asl, &Cpu::ZeroPageX>)  \
+  X(0x17, Modify<&Cpu::Slo, &Cpu::ZeroPageX>)  \
+  X(0x18, ClcImplied)                          \
+  X(0x19, Read<&Cpu::Ora, &Cpu::AbsoluteY>)    \
+  X(0x1A, NopImplied)                          \
+  X(0x1B, Modify<&Cpu::Slo, &Cpu::AbsoluteYW>) \
+  X(0x1C, Nop<&Cpu::AbsoluteX>)                \
+  X(0x1D, Read<&Cpu::Ora, &Cpu::AbsoluteX>)    \
+  X(0x1E, Modify<&Cpu::Asl, &Cpu::AbsoluteXW>) \
+  X(0x1F, Modify<&Cpu::Slo, &Cpu::AbsoluteXW>) \
+  X(0x20, JsrAbsolute)                         \
+  X(0x21, Read<&Cpu::And, &Cpu::IndirectX>)    \
+  X(0x22, Stp)                                 \
+  X(0x23, Modify<&Cpu::Rla, &Cpu::IndirectX>)  \
+  X(0x24, Read<&Cpu::Bit, &Cpu::ZeroPage>)     \
+  X(0x25, Read<&Cpu::And, &Cpu::ZeroPage>)     \
+  X(0x26, Modify<&Cpu::Rol, &Cpu::ZeroPage>)   \
+  X(0x27, Modify<&Cpu::Rla, &Cpu::ZeroPage>)   \
+  X(0x28, PlpImplied)                          \
+  X(0x29, Immediate<&Cpu::And>)                \
+  X(0x2A, Accumulator<&Cpu::Rol>)              \
+  X(0x2B, Immediate<&Cpu::Anc>)                \
+  X(0x2C, Read<&Cpu::Bit, &Cpu::Absolute>)     \
+  X(0x2D, Read<&Cpu::And, &Cpu::Absolute>)     \
+  X(0x2E, Modify<&Cpu::Rol, &Cpu::Absolute>)   \
+  X(0x2F, Modify<&Cpu::Rla, &Cpu::Absolute>)   \
+  X(0x30, BmiRelative)                         \
+  X(0x31, Read<&Cpu::And, &Cpu::IndirectY>)    \
+  X(0x32, Stp)                                 \
+  X(0x33, Modify<&Cpu::Rla, &Cpu::IndirectYW>) \
+  X(0x34, Nop<&Cpu::ZeroPageX>)                \
+  X(0x35, Read<&Cpu::And, &Cpu::ZeroPageX>)    \
+  X(0x36, Modify<&Cpu::Rol, &Cpu::ZeroPageX>)  \
+  X(0x37, Modify<&Cpu::Rla, &Cpu::ZeroPageX>)  \
+  X(0x38, SecImplied)                          \
+  X(0x39, Read<&Cpu::And, &Cpu::AbsoluteY>)    \
+  X(0x3A, NopImplied)                          \
+  X(0x3B, Modify<&Cpu::Rla, &Cpu::AbsoluteYW>) \
+  X(0x3C, Nop<&Cpu::AbsoluteX>)                \
+  X(0x3D, Read<&Cpu::And, &Cpu::AbsoluteX>)    \
+  X(0x3E, Modify<&Cpu::Rol, &Cpu::AbsoluteXW>) \
+  X(0x3F, Modify<&Cpu::Rla, &Cpu::AbsoluteXW>) \
+  X(0x40, RtiImplied)                          \
+  X(0x41, Read<&Cpu::Eor, &Cpu::IndirectX>)    \
+  X(0x42, Stp)                                 \
+  X(0x43, Modify<&Cpu::Sre, &Cpu::IndirectX>)  \
+  X(0x44, Nop<&Cpu::ZeroPage>)                 \
+  X(0x45, Read<&Cpu::Eor, &Cpu::ZeroPage>)     \
+  X(0x46, Modify<&Cpu::Lsr, &Cpu::ZeroPage>)   \
+  X(0x47, Modify<&Cpu::Sre, &Cpu::ZeroPage>)   \
+  X(0x48, PhaImplied)                          \
+  X(0x49, Immediate<&Cpu::Eor>)                \
+  X(0x4A, Accumulator<&Cpu::Lsr>)              \
+  X(0x4B, Immediate<&Cpu::Alr>)                \
+  X(0x4C, JmpAbsolute)                         \
+  X(0x4D, Read<&Cpu::Eor, &Cpu::Absolute>)     \
+  X(0x4E, Modify<&Cpu::Lsr, &Cpu::Absolute>)   \
+  X(0x4F, Modify<&Cpu::Sre, &Cpu::Absolute>)   \
+  X(0x50, BvcRelative)                         \
+  X(0x51, Read<&Cpu::Eor, &Cpu::IndirectY>)    \
+  X(0x52, Stp)                                 \
+  X(0x53, Modify<&Cpu::Sre, &Cpu::IndirectYW>) \
+  X(0x54, Nop<&Cpu::ZeroPageX>)                \
+  X(0x55, Read<&Cpu::Eor, &Cpu::ZeroPageX>)    \
+  X(0x56, Modify<&Cpu::Lsr, &Cpu::ZeroPageX>)  \
+  X(0x57, Modify<&Cpu::Sre, &Cpu::ZeroPageX>)  \
+  X(0x58, CliImplied)                          \
+  X(0x59, Read<&Cpu::Eor, &Cpu::AbsoluteY>)    \
+  X(0x5A, NopImplied)                          \
+  X(0x5B, Modify<&Cpu::Sre, &Cpu::AbsoluteY>)  \
+  X(0x5C, Nop<&Cpu::AbsoluteX>)                \
+  X(0x5D, Read<&Cpu::Eor, &Cpu::AbsoluteX>)    \
+  X(0x5E, Modify<&Cpu::Lsr, &Cpu::AbsoluteXW>) \
+  X(0x5F, Modify<&Cpu::Sre, &Cpu::AbsoluteXW>) \
+  X(0x60, RtsImplied)                          \
+  X(0x61, Read<&Cpu::Adc, &Cpu::IndirectX>)    \
+  X(0x62, Stp)                                 \
+  X(0x63, Modify<&Cpu::Rra, &Cpu::IndirectX>)  \
+  X(0x64, Nop<&Cpu::ZeroPage>)                 \
+  X(0x65, Read<&Cpu::Adc, &Cpu::ZeroPage>)     \
+  X(0x66, Modify<&Cpu::Ror, &Cpu::ZeroPage>)   \
+  X(0x67, Modify<&Cpu::Rra, &Cpu::ZeroPage>)   \
+  X(0x68, PlaImplied)                          \
+  X(0x69, Immediate<&Cpu::Adc>)                \
+  X(0x6A, Accumulator<&Cpu::Ror>)              \
+  X(0x6B, Immediate<&Cpu::Arr>)                \
+  X(0x6C, JmpIndirect)                         \
+  X(0x6D, Read<&Cpu::Adc, &Cpu::Absolute>)     \
+  X(0x6E, Modify<&Cpu::Ror, &Cpu::Absolute>)   \
+  X(0x6F, Modify<&Cpu::Rra, &Cpu::Absolute>)   \
+  X(0x70, BvsRelative)                         \
+  X(0x71, Read<&Cpu::Adc, &Cpu::IndirectY>)    \
+  X(0x72, Stp)                                 \
+  X(0x73, Modify<&Cpu::Rra, &Cpu::IndirectYW>) \
+  X(0x74, Nop<&Cpu::ZeroPageX>)                \
+  X(0x75, Read<&Cpu::Adc, &Cpu::ZeroPageX>)    \
+  X(0x76, Modify<&Cpu::Ror, &Cpu::ZeroPageX>)  \
+  X(0x77, Modify<&Cpu::Rra, &Cpu::ZeroPageX>)  \
+  X(0x78, SeiImplied)                          \
+  X(0x79, Read<&Cpu::Adc, &Cpu::AbsoluteY>)    \
+  X(0x7A, NopImplied)                          \
+  X(0x7B, Modify<&Cpu::Rra, &Cpu::AbsoluteYW>) \
+  X(0x7C, Nop<&Cpu::AbsoluteX>)                \
+  X(0x7D, Read<&Cpu::Adc, &Cpu::AbsoluteX>)    \
+  X(0x7E, Modify<&Cpu::Ror, &Cpu::AbsoluteXW>) \
+  X(0x7F, Modify<&Cpu::Rra, &Cpu::AbsoluteXW>) \
+  X(0x80, NopImmediate)                        \
+  X(0x81, Write<&Cpu::Sta, &Cpu::IndirectX>)   \
+  X(0x82, NopImmediate)                        \
+  X(0x83, Write<&Cpu::Sax, &Cpu::IndirectX>)   \
+  X(0x84, Write<&Cpu::Sty, &Cpu::ZeroPage>)    \
+  X(0x85, Write<&Cpu::Sta, &Cpu::ZeroPage>)    \
+  X(0x86, Write<&Cpu::Stx, &Cpu::ZeroPage>)    \
+  X(0x87, Write<&Cpu::Sax, &Cpu::ZeroPage>)    \
+  X(0x88, DeyImplied)                          \
+  X(0x89, NopImmediate)                        \
+  X(0x8A, TxaImplied)                          \
+  X(0x8B, Immediate<&Cpu::Ane>)                \
+  X(0x8C, Write<&Cpu::Sty, &Cpu::Absolute>)    \
+  X(0x8D, Write<&Cpu::Sta, &Cpu::Absolute>)    \
+  X(0x8E, Write<&Cpu::Stx, &Cpu::Absolute>)    \
+  X(0x8F, Write<&Cpu::Sax, &Cpu::Absolute>)    \
+  X(0x90, BccRelative)                         \
+  X(0x91, Write<&Cpu::Sta, &Cpu::IndirectYW>)  \
+  X(0x92, Stp)                                 \
+  X(0x93, Write<&Cpu::Sha, &Cpu::IndirectYW>)  \
+  X(0x94, Write<&Cpu::Sty, &Cpu::ZeroPageX>)   \
+  X(0x95, Write<&Cpu::Sta, &Cpu::ZeroPageX>)   \
+  X(0x96, Write<&Cpu::Stx, &Cpu::ZeroPageY>)   \
+  X(0x97, Write<&Cpu::Sax, &Cpu::ZeroPageY>)   \
+  X(0x98, TyaImplied)                          \
+  X(0x99, Write<&Cpu::Sta, &Cpu::AbsoluteYW>)  \
+  X(0x9A, TxsImplied)                          \
+  X(0x9B, Write<&Cpu::Tas, &Cpu::AbsoluteY>)   \
+  X(0x9C, ShyAbsoluteX)                        \
+  X(0x9D, Write<&Cpu::Sta, &Cpu::AbsoluteXW>)  \
+  X(0x9E, ShxAbsoluteY)                        \
+  X(0x9F, Write<&Cpu::Sha, &Cpu::AbsoluteYW>)  \
+  X(0xA0, Immediate<&Cpu::Ldy>)                \
+  X(0xA1, Read<&Cpu::Lda, &Cpu::IndirectX>)    \
+  X(0xA2, Immediate<&Cpu::Ldx>)                \
+  X(0xA3, Read<&Cpu::Lax, &Cpu::IndirectX>)    \
+  X(0xA4, Read<&Cpu::Ldy, &Cpu::ZeroPage>)     \
+  X(0xA5, Read<&Cpu::Lda, &Cpu::ZeroPage>)     \
+  X(0xA6, Read<&Cpu::Ldx, &Cpu::ZeroPage>)     \
+  X(0xA7, Read<&Cpu::Lax, &Cpu::ZeroPage>)     \
+  X(0xA8, TayImplied)                          \
+  X(0xA9, Immediate<&Cpu::Lda>)                \
+  X(0xAA, TaxImplied)                          \
+  X(0xAB, Immediate<&Cpu::Lxa>)                \
+  X(0xAC, Read<&Cpu::Ldy, &Cpu::Absolute>)     \
+  X(0xAD, Read<&Cpu::Lda, &Cpu::Absolute>)     \
+  X(0xAE, Read<&Cpu::Ldx, &Cpu::Absolute>)     \
+  X(0xAF, Read<&Cpu::Lax, &Cpu::Absolute>)     \
+  X(0xB0, BcsRelative)                         \
+  X(0xB1, Read<&Cpu::Lda, &Cpu::IndirectY>)    \
+  X(0xB2, Stp)                                 \
+  X(0xB3, Read<&Cpu::Lax, &Cpu::IndirectYW>)   \
+  X(0xB4, Read<&Cpu::Ldy, &Cpu::ZeroPageX>)    \
+  X(0xB5, Read<&Cpu::Lda, &Cpu::ZeroPageX>)    \
+  X(0xB6, Read<&Cpu::Ldx, &Cpu::ZeroPageY>)    \
+  X(0xB7, Read<&Cpu::Lax, &Cpu::ZeroPageY>)    \
+  X(0xB8, ClvImplied)                          \
+  X(0xB9, LdaAbsoluteY)                        \
+  X(0xBA, TsxImplied)                          \
+  X(0xBB, Read<&Cpu::Las, &Cpu::AbsoluteY>)    \
+  X(0xBC, Read<&Cpu::Ldy, &Cpu::AbsoluteX>)    \
+  X(0xBD, Read<&Cpu::Lda, &Cpu::AbsoluteX>)    \
+  X(0xBE, Read<&Cpu::Ldx, &Cpu::AbsoluteY>)    \
+  X(0xBF, Read<&Cpu::Lax, &Cpu::AbsoluteY>)    \
+  X(0xC0, Immediate<&Cpu::Cpy>)                \
+  X(0xC1, Read<&Cpu::Cmp, &Cpu::IndirectX>)    \
+  X(0xC2, NopImmediate)                        \
+  X(0xC3, Modify<&Cpu::Dcp, &Cpu::IndirectX>)  \
+  X(0xC4, Read<&Cpu::Cpy, &Cpu::ZeroPage>)     \
+  X(0xC5, Read<&Cpu::Cmp, &Cpu::ZeroPage>)     \
+  X(0xC6, Modify<&Cpu::Dec, &Cpu::ZeroPage>)   \
+  X(0xC7, Modify<&Cpu::Dcp, &Cpu::ZeroPage>)   \
+  X(0xC8, InyImplied)                          \
+  X(0xC9, Immediate<&Cpu::Cmp>)                \
+  X(0xCA, DexImplied)                          \
+  X(0xCB, Immediate<&Cpu::Sbx>)                \
+  X(0xCC, Read<&Cpu::Cpy, &Cpu::Absolute>)     \
+  X(0xCD, Read<&Cpu::Cmp, &Cpu::Absolute>)     \
+  X(0xCE, Modify<&Cpu::Dec, &Cpu::Absolute>)   \
+  X(0xCF, Modify<&Cpu::Dcp, &Cpu::Absolute>)   \
+  X(0xD0, BneRelative)                         \
+  X(0xD1, Read<&Cpu::Cmp, &Cpu::IndirectY>)    \
+  X(0xD2, Stp)                                 \
+  X(0xD3, Modify<&Cpu::Dcp, &Cpu::IndirectYW>) \
+  X(0xD4, Nop<&Cpu::ZeroPageX>)                \
+  X(0xD5, Read<&Cpu::Cmp, &Cpu::ZeroPageX>)    \
+  X(0xD6, Modify<&Cpu::Dec, &Cpu::ZeroPageX>)  \
+  X(0xD7, Modify<&Cpu::Dcp, &Cpu::ZeroPageX>)  \
+  X(0xD8, CldImplied)                          \
+  X(0xD9, Read<&Cpu::Cmp, &Cpu::AbsoluteY>)    \
+  X(0xDA, NopImplied)                          \
+  X(0xDB, Modify<&Cpu::Dcp, &Cpu::AbsoluteYW>) \
+  X(0xDC, Nop<&Cpu::AbsoluteX>)                \
+  X(0xDD, Read<&Cpu::Cmp, &Cpu::AbsoluteX>)    \
+  X(0xDE, Modify<&Cpu::Dec, &Cpu::AbsoluteXW>) \
+  X(0xDF, Modify<&Cpu::Dcp, &Cpu::AbsoluteXW>) \
+  X(0xE0, Immediate<&Cpu::Cpx>)                \
+  X(0xE1, Read<&Cpu::Sbc, &Cpu::IndirectX>)    \
+  X(0xE2, NopImmediate)                        \
+  X(0xE3, Modify<&Cpu::Isc, &Cpu::IndirectX>)  \
+  X(0xE4, Read<&Cpu::Cpx, &Cpu::ZeroPage>)     \
+  X(0xE5, Read<&Cpu::Sbc, &Cpu::ZeroPage>)     \
+  X(0xE6, Modify<&Cpu::Inc, &Cpu::ZeroPage>)   \
+  X(0xE7, Modify<&Cpu::Isc, &Cpu::ZeroPage>)   \
+  X(0xE8, InxImplied)                          \
+  X(0xE9, Immediate<&Cpu::Sbc>)                \
+  X(0xEA, NopImplied)                          \
+  X(0xEB, Immediate<&Cpu::Sbc>)                \
+  X(0xEC, Read<&Cpu::Cpx, &Cpu::Absolute>)     \
+  X(0xED, Read<&Cpu::Sbc, &Cpu::Absolute>)     \
+  X(0xEE, Modify<&Cpu::Inc, &Cpu::Absolute>)   \
+  X(0xEF, Modify<&Cpu::Isc, &Cpu::Absolute>)   \
+  X(0xF0, BeqRelative)                         \
+  X(0xF1, Read<&Cpu::Sbc, &Cpu::IndirectY>)    \
+  X(0xF2, Stp)                                 \
+  X(0xF3, Modify<&Cpu::Isc, &Cpu::IndirectYW>) \
+  X(0xF4, Nop<&Cpu::ZeroPageX>)                \
+  X(0xF5, Read<&Cpu::Sbc, &Cpu::ZeroPageX>)    \
+  X(0xF6, Modify<&Cpu::Inc, &Cpu::ZeroPageX>)  \
+  X(0xF7, Modify<&Cpu::Isc, &Cpu::ZeroPageX>)  \
+  X(0xF8, SedImplied)                          \
+  X(0xF9, Read<&Cpu::Sbc, &Cpu::AbsoluteY>)    \
+  X(0xFA, NopImplied)                          \
+  X(0xFB, Modify<&Cpu::Isc, &Cpu::AbsoluteY>)  \
+  X(0xFC, Nop<&Cpu::AbsoluteX>)                \
+  X(0xFD, Read<&Cpu::Sbc, &Cpu::AbsoluteX>)    \
+  X(0xFE, Modify<&Cpu::Inc, &Cpu::AbsoluteXW>) \
+  X(0xFF, Modify<&Cpu::Isc, &Cpu::AbsoluteX>)
+
+namespace cpu {
+
+// The handler of every opcode as spelled above, for tools and reports.
+#define OPCODE_HANDLER_NAME(code, ...) #__VA_ARGS__,
+inline constexpr const char* OPCODE_HANDLERS[256] = {
+    CPU_OPCODES(OPCODE_HANDLER_NAME)};
+#undef OPCODE_HANDLER_NAME
+
+// Bytes an instruction is fetched from, going by its handler's addressing
+// mode. BRK fetches the byte after it as well.
+constexpr uint8_t OpcodeLength(std::string_view handler) {
+  if (handler.find("Absolute") != std::string_view::npos ||
+      handler == "JmpIndirect") {
+    return 3;
+  } else if (handler == "BrkImplied") {
+    return 2;
+  } else if (handler.find("Implied") != std::string_view::npos ||
+             handler.find("Accumulator") != std::string_view::npos ||
+             handler == "Stp") {
+    return 1;
+  } else {
+    return 2;
+  }
+}
+
+inline constexpr std::array<uint8_t, 256> OPCODE_LENGTHS = [] {
+  std::array<uint8_t, 256> lengths = {};
+  for (int i = 0; i < 256; i++) {
+    lengths[i] = OpcodeLength(OPCODE_HANDLERS[i]);
+  }
+  return lengths;
+}();
+
+}  // namespace cpu
+
+#endif  // SRC_CPU_OPCODES_H_
@@ -0,0 +1,40 @@
+#include "prg_rom_map.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "src/mappers/mapper.h"
+
+namespace cpu {
+
+PrgRomMap::PrgRomMap(std::shared_ptr<mappers::Mapper> mapper)
+    : cartridge(std::move(mapper)), slot_offsets() {
+  size = cartridge->PrgRomSize();
+  prg_rom_writes = cartridge->prg_rom_writes;
+  RemapSlots();
+}
+
+uint64_t PrgRomMap::Offset(uint16_t addr) {
+  if (cartridge->bank_switches != bank_switches) {
+    RemapSlots();
+  }
+
+  return slot_offsets[(addr >> 12) & 0x7] + (addr & 0xFFF);
+}
+
+void PrgRomMap::RemapSlots() {
+  bank_switches = cartridge->bank_switches;
+
+  for (int i = 0; i < PRG_SLOTS; i++) {
+    uint64_t offset = cartridge->PrgRomOffset(0x8000 + i * PRG_SLOT_SIZE);
+
+    if (offset + PRG_SLOT_SIZE > size) {
+      offset = size;
+    }
+
+    slot_offsets[i] = offset;
+  }
+}
+
+}  // namespace cpu
@@ -0,0 +1,77 @@
+#ifndef SRC_CPU_PRG_ROM_MAP_H_
+#define SRC_CPU_PRG_ROM_MAP_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "src/mappers/mapper.h"
+
+namespace cpu {
+
+constexpr int PRG_SLOT_SIZE = 0x1000;
+constexpr int PRG_SLOTS = 8;
+
+/*
+  Which PRG-ROM offset each 4K slot of 0x8000-0xFFFF currently maps to,
+  following the mapper's bank switches. Slots mapped past the end of PRG-ROM
+  report offsets starting at Size(), so tables indexed by offset need
+  Size() + PRG_SLOT_SIZE entries.
+*/
+class PrgRomMap {
+ public:
+  PrgRomMap(std::shared_ptr<mappers::Mapper> mapper);
+
+  // addr must be in 0x8000-0xFFFF
+  uint64_t Offset(uint16_t addr);
+  uint64_t Size() { return size; }
+  // Calls written(begin, end) for the PRG-ROM offsets written since the last
+  // call. Once more were written than the mapper remembers, that is the
+  // whole range tables indexed by offset cover.
+  template <typename Written>
+  void TakeRomWrites(Written written);
+  // see Mapper::MayBeCheated
+  bool MayBeCheated(uint16_t addr) { return cartridge->MayBeCheated(addr); }
+
+ private:
+  void RemapSlots();
+
+  std::shared_ptr<mappers::Mapper> cartridge;
+  std::array<uint64_t, PRG_SLOTS> slot_offsets;
+  uint64_t size;
+  uint64_t bank_switches = 0;
+  uint64_t prg_rom_writes = 0;
+};
+
+template <typename Written>
+void PrgRomMap::TakeRomWrites(Written written) {
+  uint64_t writes = cartridge->prg_rom_writes;
+
+  if (writes == prg_rom_writes) {
+    return;
+  }
+
+  uint64_t first = prg_rom_writes;
+  prg_rom_writes = writes;
+
+  if (writes - first > mappers::PRG_ROM_WRITE_LOG) {
+    written(0, size + PRG_SLOT_SIZE);
+    return;
+  }
+
+  for (uint64_t n = first; n < writes; n++) {
+    uint64_t offset =
+        cartridge->prg_rom_written[n % mappers::PRG_ROM_WRITE_LOG];
+
+    if (offset == mappers::PRG_ROM_ALL) {
+      written(0, size + PRG_SLOT_SIZE);
+      return;
+    }
+
+    written(offset, offset + 1);
+  }
+}
+
+}  // namespace cpu
+
+#endif  // SRC_CPU_PRG_ROM_MAP_H_
@@ -0,0 +1,71 @@
+#include "profile.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
+#include <ostream>
+#include <utility>
+
+#include "src/cpu/opcodes.h"
+
+namespace cpu {
+
+namespace {
+
+void WriteBucket(std::ostream& out, const Profile& profile, int bucket) {
+  out << "\"count\": " << profile.count[bucket]
+      << ", \"cycles\": " << profile.cycles[bucket] << ", \"histogram\": [";
+
+  for (int i = 0; i < PROFILE_MAX_CYCLES; i++) {
+    out << (i > 0 ? ", " : "") << profile.histogram[bucket][i];
+  }
+
+  out << "]";
+}
+
+}  // namespace
+
+void Profile::WriteJson(std::ostream& out) const {
+  uint64_t total = std::accumulate(cycles.begin(), cycles.end(), uint64_t{0});
+
+  out << "{\n";
+  out << "  \"cycles\": " << total << ",\n";
+  out << "  \"page_crosses\": " << page_crosses << ",\n";
+  out << "  \"dmc_stall_cycles\": " << dmc_stall_cycles << ",\n";
+
+  const std::pair<const char*, int> others[] = {
+      {"nmi", PROFILE_NMI},
+      {"irq", PROFILE_IRQ},
+      {"oam_dma", PROFILE_OAM_DMA},
+      {"idle_skip", PROFILE_IDLE_SKIP},
+      {"jit_block", PROFILE_JIT_BLOCK},
+  };
+
+  for (const auto& [name, bucket] : others) {
+    out << "  \"" << name << "\": {";
+    WriteBucket(out, *this, bucket);
+    out << "},\n";
+  }
+
+  out << "  \"opcodes\": [";
+  bool first = true;
+
+  for (int opcode = 0; opcode < 256; opcode++) {
+    if (count[opcode] == 0) {
+      continue;
+    }
+
+    char code[8];
+    std::snprintf(code, sizeof(code), "0x%02X", opcode);
+
+    out << (first ? "\n" : ",\n") << "    {\"opcode\": \"" << code
+        << "\", \"handler\": \"" << OPCODE_HANDLERS[opcode] << "\", ";
+    WriteBucket(out, *this, opcode);
+    out << "}";
+    first = false;
+  }
+
+  out << "\n  ]\n}\n";
+}
+
+}  // namespace cpu
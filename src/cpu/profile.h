@@ -0,0 +1,84 @@
+#ifndef SRC_CPU_PROFILE_H_
+#define SRC_CPU_PROFILE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+#include "src/features/features.h"
+
+/*
+  Execution counters, compiled in with NESEMU_FEATURES_FULL. Otherwise every
+  counter update sits behind `if constexpr (PROFILE_ENABLED)` and is
+  compiled out.
+*/
+namespace cpu {
+
+constexpr bool PROFILE_ENABLED = features::ENABLED.profile;
+
+// Buckets 0-255 are opcodes; the rest is CPU time not spent in an
+// instruction the interpreter decoded.
+constexpr int PROFILE_NMI = 256;
+constexpr int PROFILE_IRQ = 257;
+constexpr int PROFILE_OAM_DMA = 258;
+constexpr int PROFILE_IDLE_SKIP = 259;
+constexpr int PROFILE_JIT_BLOCK = 260;
+constexpr int PROFILE_BUCKETS = 261;
+
+// Cycle histogram bins; the last one also counts anything longer.
+constexpr int PROFILE_MAX_CYCLES = 16;
+
+/*
+  Every cycle is charged to the bucket that was last begun, so a bucket's
+  cycles include the page crossing and DMC stall cycles spent inside it.
+*/
+class Profile {
+ public:
+  // Ends the running entry at `start` and begins one in `bucket`.
+  void Begin(int bucket, uint64_t start) {
+    End(start);
+    current = bucket;
+    entry_start = start;
+    entry_cycles = 0;
+    count[bucket]++;
+  }
+
+  // Charges the running entry with the cycles up to `now`, leaving it open.
+  void Flush(uint64_t now) {
+    if (current >= 0) {
+      cycles[current] += now - entry_start;
+      entry_cycles += now - entry_start;
+      entry_start = now;
+    }
+  }
+
+  void WriteJson(std::ostream& out) const;
+
+  std::array<uint64_t, PROFILE_BUCKETS> count = {};
+  std::array<uint64_t, PROFILE_BUCKETS> cycles = {};
+  // how many entries of each bucket took a given number of cycles
+  std::array<std::array<uint64_t, PROFILE_MAX_CYCLES>, PROFILE_BUCKETS>
+      histogram = {};
+  // extra cycles from indexed reads that crossed a page
+  uint64_t page_crosses = 0;
+  // extra cycles the DMC took to fetch samples
+  uint64_t dmc_stall_cycles = 0;
+
+ private:
+  void End(uint64_t now) {
+    if (current >= 0) {
+      Flush(now);
+      histogram[current][std::min<uint64_t>(entry_cycles,
+                                            PROFILE_MAX_CYCLES - 1)]++;
+    }
+  }
+
+  int current = -1;
+  uint64_t entry_start = 0;
+  uint64_t entry_cycles = 0;
+};
+
+}  // namespace cpu
+
+#endif  // SRC_CPU_PROFILE_H_
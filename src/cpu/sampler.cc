@@ -0,0 +1,60 @@
+#include "sampler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "src/mappers/mapper.h"
+
+namespace cpu {
+
+Sampler::Sampler(std::shared_ptr<mappers::Mapper> mapper, uint64_t interval,
+                 uint64_t now)
+    : rom(std::move(mapper)), interval(interval), next_sample(now + interval) {
+  if (interval == 0) {
+    throw "Sampling interval must be at least one cycle";
+  }
+
+  histogram.resize(SAMPLE_ROM + rom.Size() + PRG_SLOT_SIZE);
+  addresses.resize(histogram.size());
+  frame_histogram.resize(histogram.size());
+}
+
+uint32_t Sampler::Key(uint16_t addr) {
+  if (addr < 0x8000) {
+    return addr;
+  }
+
+  return SAMPLE_ROM + static_cast<uint32_t>(rom.Offset(addr));
+}
+
+void Sampler::Record(uint16_t PC) {
+  uint32_t key = Key(PC);
+  histogram[key]++;
+  addresses[key] = PC;
+  samples++;
+
+  if (frame_histogram[key]++ == 0) {
+    frame_keys.push_back(key);
+  }
+}
+
+void Sampler::EndFrame() {
+  last_frame.clear();
+
+  for (uint32_t key : frame_keys) {
+    last_frame.push_back({key, frame_histogram[key]});
+    frame_histogram[key] = 0;
+  }
+
+  frame_keys.clear();
+  std::sort(last_frame.begin(), last_frame.end(),
+            [](const SampleCount& a, const SampleCount& b) {
+              return a.samples > b.samples ||
+                     (a.samples == b.samples && a.key < b.key);
+            });
+}
+
+}  // namespace cpu
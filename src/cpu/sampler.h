@@ -0,0 +1,73 @@
+#ifndef SRC_CPU_SAMPLER_H_
+#define SRC_CPU_SAMPLER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "src/cpu/prg_rom_map.h"
+#include "src/mappers/mapper.h"
+
+namespace cpu {
+
+// Sample keys below this are CPU addresses, the rest PRG-ROM offsets plus
+// SAMPLE_ROM, so code in different banks at the same address is told apart.
+constexpr uint32_t SAMPLE_ROM = 0x8000;
+constexpr uint64_t SAMPLE_PRG_BANK_SIZE = 0x4000;
+
+// Samples taken at one key.
+struct SampleCount {
+  uint32_t key;
+  uint64_t samples;
+};
+
+/*
+  Sampling profiler for guest code: every `interval` cycles it records which
+  instruction the CPU is at. Samples are counted in a histogram covering all
+  of RAM and PRG-ROM, and in one just for the current frame, both allocated
+  up front. EndFrame turns the frame's counts into a list that stays
+  available until the next EndFrame, so memory doesn't grow with the run.
+*/
+class Sampler {
+ public:
+  Sampler(std::shared_ptr<mappers::Mapper> mapper, uint64_t interval,
+          uint64_t now);
+
+  // Called as an instruction at PC starts. Takes one sample for every
+  // interval that ended since the last call.
+  void Sample(uint16_t PC, uint64_t now) {
+    while (now >= next_sample) {
+      Record(PC);
+      next_sample += interval;
+    }
+  }
+
+  void EndFrame();
+  // The keys sampled in the frame EndFrame last ended, most samples first.
+  const std::vector<SampleCount>& LastFrame() { return last_frame; }
+
+  uint32_t Key(uint16_t addr);
+  // CPU address a key was last sampled at
+  uint16_t Address(uint32_t key) { return addresses[key]; }
+  uint64_t Interval() { return interval; }
+
+  // samples taken at each key
+  std::vector<uint64_t> histogram;
+  uint64_t samples = 0;
+
+ private:
+  void Record(uint16_t PC);
+
+  PrgRomMap rom;
+  std::vector<uint16_t> addresses;
+  // samples at each key in the current frame, and the keys that have any
+  std::vector<uint64_t> frame_histogram;
+  std::vector<uint32_t> frame_keys;
+  std::vector<SampleCount> last_frame;
+  uint64_t interval;
+  uint64_t next_sample;
+};
+
+}  // namespace cpu
+
+#endif  // SRC_CPU_SAMPLER_H_
@@ -0,0 +1,70 @@
+#include "trace.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace cpu {
+
+Trace::Trace(const std::string& path)
+    : file(std::fopen(path.c_str(), "wb")) {
+  if (file == nullptr) {
+    throw "Could not open trace file";
+  }
+
+  std::fwrite(TRACE_MAGIC, sizeof(TRACE_MAGIC), 1, file);
+
+  for (Chunk& chunk : chunks) {
+    chunk.records.resize(TRACE_CHUNK_RECORDS);
+  }
+
+  writer = std::thread(&Trace::WriteChunks, this);
+}
+
+Trace::~Trace() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    chunks[head].full = chunks[head].count > 0;
+    stopping = true;
+  }
+
+  changed.notify_all();
+  writer.join();
+  std::fclose(file);
+}
+
+void Trace::Submit() {
+  std::unique_lock<std::mutex> lock(mutex);
+  chunks[head].full = true;
+  changed.notify_all();
+
+  head = (head + 1) % TRACE_CHUNKS;
+  changed.wait(lock, [this] { return !chunks[head].full; });
+}
+
+void Trace::WriteChunks() {
+  int tail = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    changed.wait(lock, [&] { return chunks[tail].full || stopping; });
+
+    if (!chunks[tail].full) {
+      return;
+    }
+
+    Chunk& chunk = chunks[tail];
+    lock.unlock();
+    std::fwrite(chunk.records.data(), sizeof(TraceRecord), chunk.count, file);
+    lock.lock();
+
+    chunk.count = 0;
+    chunk.full = false;
+    changed.notify_all();
+    tail = (tail + 1) % TRACE_CHUNKS;
+  }
+}
+
+}  // namespace cpu
@@ -0,0 +1,82 @@
+#ifndef SRC_CPU_TRACE_H_
+#define SRC_CPU_TRACE_H_
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cpu {
+
+// first bytes of a trace file, followed by TraceRecords back to back
+constexpr char TRACE_MAGIC[8] = {'N', 'E', 'S', 'T', 'R', 'C', '0', '1'};
+constexpr uint64_t TRACE_CHUNK_RECORDS = 1 << 14;
+constexpr int TRACE_CHUNKS = 8;
+
+// CPU state as an instruction starts, before its opcode is fetched.
+struct TraceRecord {
+  uint64_t cycle;
+  uint16_t PC;
+  uint16_t dot;
+  uint16_t line;
+  uint8_t opcode;
+  // the bytes after the opcode, whether or not the instruction uses them
+  uint8_t operands[2];
+  uint8_t A;
+  uint8_t X;
+  uint8_t Y;
+  uint8_t P;
+  uint8_t SP;
+  uint8_t unused[2];
+};
+
+static_assert(sizeof(TraceRecord) == 24);
+
+/*
+  Ring of fixed-size chunks of trace records. The emulator fills one chunk at
+  a time; full chunks are written to disk by a background thread. If the
+  writer falls behind by the whole ring, Record waits for it rather than
+  dropping records.
+*/
+class Trace {
+ public:
+  Trace(const std::string& path);
+  ~Trace();
+
+  void Record(const TraceRecord& record) {
+    Chunk& chunk = chunks[head];
+    chunk.records[chunk.count++] = record;
+
+    if (chunk.count == TRACE_CHUNK_RECORDS) {
+      Submit();
+    }
+  }
+
+ private:
+  struct Chunk {
+    std::vector<TraceRecord> records;
+    uint64_t count = 0;
+    // handed to the writer and not yet written
+    bool full = false;
+  };
+
+  void Submit();
+  void WriteChunks();
+
+  std::FILE* file;
+  std::array<Chunk, TRACE_CHUNKS> chunks;
+  // chunk being filled by Record
+  int head = 0;
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool stopping = false;
+  std::thread writer;
+};
+
+}  // namespace cpu
+
+#endif  // SRC_CPU_TRACE_H_
@@ -0,0 +1,327 @@
+#include "x64_emitter.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace cpu {
+
+namespace {
+
+uint8_t Low(Reg reg) { return static_cast<uint8_t>(reg) & 0x7; }
+
+uint8_t High(Reg reg) { return static_cast<uint8_t>(reg) >> 3; }
+
+uint8_t ScaleBits(uint8_t scale) {
+  switch (scale) {
+    case 1:
+      return 0;
+    case 2:
+      return 1;
+    case 4:
+      return 2;
+    default:
+      return 3;
+  }
+}
+
+}  // namespace
+
+std::vector<uint8_t>& X64Emitter::Finish() {
+  for (auto& [pos, label] : fixups) {
+    int32_t rel = static_cast<int32_t>(labels[label] - (pos + 4));
+    for (int i = 0; i < 4; i++) {
+      code[pos + i] = static_cast<uint8_t>(rel >> (8 * i));
+    }
+  }
+
+  fixups.clear();
+  return code;
+}
+
+Label X64Emitter::NewLabel() {
+  labels.push_back(-1);
+  return static_cast<Label>(labels.size() - 1);
+}
+
+void X64Emitter::Bind(Label label) { labels[label] = code.size(); }
+
+void X64Emitter::Jmp(Label label) {
+  code.push_back(0xE9);
+  Rel32(label);
+}
+
+void X64Emitter::Jcc(Cond cond, Label label) {
+  code.push_back(0x0F);
+  code.push_back(0x80 | static_cast<uint8_t>(cond));
+  Rel32(label);
+}
+
+void X64Emitter::Ret() { code.push_back(0xC3); }
+
+/*=================================================================
+*  Loads and stores
+=================================================================*/
+void X64Emitter::MovImm32(Reg dst, uint32_t imm) {
+  Rex(false, 0, 0, High(dst));
+  code.push_back(0xB8 + Low(dst));
+  Imm32(imm);
+}
+
+void X64Emitter::Mov32(Reg dst, Reg src) {
+  Rex(false, High(src), 0, High(dst));
+  code.push_back(0x89);
+  ModRmReg(Low(src), dst);
+}
+
+void X64Emitter::Load32(Reg dst, Reg base, int32_t disp) {
+  Rex(false, High(dst), 0, High(base));
+  code.push_back(0x8B);
+  ModRmMem(Low(dst), base, disp);
+}
+
+void X64Emitter::Load64(Reg dst, Reg base, int32_t disp) {
+  Rex(true, High(dst), 0, High(base));
+  code.push_back(0x8B);
+  ModRmMem(Low(dst), base, disp);
+}
+
+void X64Emitter::Store32(Reg base, int32_t disp, Reg src) {
+  Rex(false, High(src), 0, High(base));
+  code.push_back(0x89);
+  ModRmMem(Low(src), base, disp);
+}
+
+void X64Emitter::Store64(Reg base, int32_t disp, Reg src) {
+  Rex(true, High(src), 0, High(base));
+  code.push_back(0x89);
+  ModRmMem(Low(src), base, disp);
+}
+
+void X64Emitter::Store32Indexed(Reg base, Reg index, uint8_t scale,
+                                Reg src) {
+  Rex(false, High(src), High(index), High(base));
+  code.push_back(0x89);
+  ModRmIndexed(Low(src), base, index, scale);
+}
+
+void X64Emitter::Movzx8(Reg dst, Reg base, int32_t disp) {
+  Rex(false, High(dst), 0, High(base));
+  code.push_back(0x0F);
+  code.push_back(0xB6);
+  ModRmMem(Low(dst), base, disp);
+}
+
+void X64Emitter::Movzx8Indexed(Reg dst, Reg base, Reg index) {
+  Rex(false, High(dst), High(index), High(base));
+  code.push_back(0x0F);
+  code.push_back(0xB6);
+  ModRmIndexed(Low(dst), base, index, 1);
+}
+
+void X64Emitter::Movzx8Reg(Reg dst, Reg src) {
+  Rex(false, High(dst), 0, High(src));
+  code.push_back(0x0F);
+  code.push_back(0xB6);
+  ModRmReg(Low(dst), src);
+}
+
+void X64Emitter::Store8(Reg base, int32_t disp, Reg src) {
+  Rex(false, High(src), 0, High(base));
+  code.push_back(0x88);
+  ModRmMem(Low(src), base, disp);
+}
+
+void X64Emitter::Store8Indexed(Reg base, Reg index, Reg src) {
+  Rex(false, High(src), High(index), High(base));
+  code.push_back(0x88);
+  ModRmIndexed(Low(src), base, index, 1);
+}
+
+void X64Emitter::Store8Imm(Reg base, int32_t disp, uint8_t imm) {
+  Rex(false, 0, 0, High(base));
+  code.push_back(0xC6);
+  ModRmMem(0, base, disp);
+  code.push_back(imm);
+}
+
+void X64Emitter::Store16(Reg base, int32_t disp, Reg src) {
+  code.push_back(0x66);
+  Rex(false, High(src), 0, High(base));
+  code.push_back(0x89);
+  ModRmMem(Low(src), base, disp);
+}
+
+void X64Emitter::Store16Imm(Reg base, int32_t disp, uint16_t imm) {
+  code.push_back(0x66);
+  Rex(false, 0, 0, High(base));
+  code.push_back(0xC7);
+  ModRmMem(0, base, disp);
+  code.push_back(static_cast<uint8_t>(imm));
+  code.push_back(static_cast<uint8_t>(imm >> 8));
+}
+
+/*=================================================================
+*  Arithmetic
+=================================================================*/
+void X64Emitter::Alu8(Alu op, Reg dst, Reg src) {
+  Rex(false, High(src), 0, High(dst));
+  code.push_back(static_cast<uint8_t>(op) << 3);
+  ModRmReg(Low(src), dst);
+}
+
+void X64Emitter::Alu8Imm(Alu op, Reg dst, uint8_t imm) {
+  Rex(false, 0, 0, High(dst));
+  code.push_back(0x80);
+  ModRmReg(static_cast<uint8_t>(op), dst);
+  code.push_back(imm);
+}
+
+void X64Emitter::Alu32(Alu op, Reg dst, Reg src) {
+  Rex(false, High(src), 0, High(dst));
+  code.push_back((static_cast<uint8_t>(op) << 3) | 0x1);
+  ModRmReg(Low(src), dst);
+}
+
+void X64Emitter::Alu32Imm(Alu op, Reg dst, int32_t imm) {
+  Rex(false, 0, 0, High(dst));
+  code.push_back(0x81);
+  ModRmReg(static_cast<uint8_t>(op), dst);
+  Imm32(static_cast<uint32_t>(imm));
+}
+
+void X64Emitter::Alu32Mem(Alu op, Reg dst, Reg base, int32_t disp) {
+  Rex(false, High(dst), 0, High(base));
+  code.push_back((static_cast<uint8_t>(op) << 3) | 0x3);
+  ModRmMem(Low(dst), base, disp);
+}
+
+void X64Emitter::Alu64Imm(Alu op, Reg dst, int32_t imm) {
+  Rex(true, 0, 0, High(dst));
+  code.push_back(0x81);
+  ModRmReg(static_cast<uint8_t>(op), dst);
+  Imm32(static_cast<uint32_t>(imm));
+}
+
+void X64Emitter::Shift8(Shift op, Reg dst) {
+  Rex(false, 0, 0, High(dst));
+  code.push_back(0xD0);
+  ModRmReg(static_cast<uint8_t>(op), dst);
+}
+
+void X64Emitter::Shl32(Reg dst, uint8_t count) {
+  Rex(false, 0, 0, High(dst));
+  code.push_back(0xC1);
+  ModRmReg(static_cast<uint8_t>(Shift::Shl), dst);
+  code.push_back(count);
+}
+
+void X64Emitter::Shr32(Reg dst, uint8_t count) {
+  Rex(false, 0, 0, High(dst));
+  code.push_back(0xC1);
+  ModRmReg(static_cast<uint8_t>(Shift::Shr), dst);
+  code.push_back(count);
+}
+
+void X64Emitter::Inc8(Reg dst) {
+  Rex(false, 0, 0, High(dst));
+  code.push_back(0xFE);
+  ModRmReg(0, dst);
+}
+
+void X64Emitter::Dec8(Reg dst) {
+  Rex(false, 0, 0, High(dst));
+  code.push_back(0xFE);
+  ModRmReg(1, dst);
+}
+
+void X64Emitter::Inc8Mem(Reg base, int32_t disp) {
+  Rex(false, 0, 0, High(base));
+  code.push_back(0xFE);
+  ModRmMem(0, base, disp);
+}
+
+void X64Emitter::Dec8Mem(Reg base, int32_t disp) {
+  Rex(false, 0, 0, High(base));
+  code.push_back(0xFE);
+  ModRmMem(1, base, disp);
+}
+
+void X64Emitter::Inc32(Reg dst) {
+  Rex(false, 0, 0, High(dst));
+  code.push_back(0xFF);
+  ModRmReg(0, dst);
+}
+
+void X64Emitter::Test8(Reg a, Reg b) {
+  Rex(false, High(b), 0, High(a));
+  code.push_back(0x84);
+  ModRmReg(Low(b), a);
+}
+
+void X64Emitter::Test32Imm(Reg a, uint32_t imm) {
+  Rex(false, 0, 0, High(a));
+  code.push_back(0xF7);
+  ModRmReg(0, a);
+  Imm32(imm);
+}
+
+void X64Emitter::Setcc(Cond cond, Reg base, int32_t disp) {
+  Rex(false, 0, 0, High(base));
+  code.push_back(0x0F);
+  code.push_back(0x90 | static_cast<uint8_t>(cond));
+  ModRmMem(0, base, disp);
+}
+
+/*=================================================================
+*  Encoding
+=================================================================*/
+void X64Emitter::Rex(bool w, uint8_t reg, uint8_t index, uint8_t base) {
+  uint8_t rex = 0x40 | (w << 3) | (reg << 2) | (index << 1) | base;
+
+  if (rex != 0x40) {
+    code.push_back(rex);
+  }
+}
+
+void X64Emitter::ModRmMem(uint8_t reg, Reg base, int32_t disp) {
+  // mod = 10: [base + disp32]
+  code.push_back(0x80 | (reg << 3) | Low(base));
+
+  if (Low(base) == Low(Reg::Rsp)) {
+    code.push_back(0x24);
+  }
+
+  Imm32(static_cast<uint32_t>(disp));
+}
+
+void X64Emitter::ModRmIndexed(uint8_t reg, Reg base, Reg index,
+                              uint8_t scale) {
+  if (Low(base) == Low(Reg::Rbp)) {
+    // mod = 01 with a zero disp8, since mod = 00 would mean no base
+    code.push_back(0x44 | (reg << 3));
+    code.push_back((ScaleBits(scale) << 6) | (Low(index) << 3) | Low(base));
+    code.push_back(0x00);
+    return;
+  }
+
+  code.push_back(0x04 | (reg << 3));
+  code.push_back((ScaleBits(scale) << 6) | (Low(index) << 3) | Low(base));
+}
+
+void X64Emitter::ModRmReg(uint8_t reg, Reg rm) {
+  code.push_back(0xC0 | (reg << 3) | Low(rm));
+}
+
+void X64Emitter::Imm32(uint32_t imm) {
+  for (int i = 0; i < 4; i++) {
+    code.push_back(static_cast<uint8_t>(imm >> (8 * i)));
+  }
+}
+
+void X64Emitter::Rel32(Label label) {
+  fixups.emplace_back(code.size(), label);
+  Imm32(0);
+}
+
+}  // namespace cpu
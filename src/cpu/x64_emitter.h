@@ -0,0 +1,124 @@
+#ifndef SRC_CPU_X64_EMITTER_H_
+#define SRC_CPU_X64_EMITTER_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace cpu {
+
+enum class Reg : uint8_t {
+  Rax = 0,
+  Rcx = 1,
+  Rdx = 2,
+  Rbx = 3,
+  Rsp = 4,
+  Rbp = 5,
+  Rsi = 6,
+  Rdi = 7,
+  R8 = 8,
+  R9 = 9,
+  R10 = 10,
+  R11 = 11,
+};
+
+// /digit of the 0x80/0x81 immediate group, also the opcode's row in the
+// register-register encodings.
+enum class Alu : uint8_t {
+  Add = 0,
+  Or = 1,
+  Adc = 2,
+  Sbb = 3,
+  And = 4,
+  Sub = 5,
+  Xor = 6,
+  Cmp = 7,
+};
+
+// /digit of the 0xD0 shift-by-one group
+enum class Shift : uint8_t {
+  Rcl = 2,
+  Rcr = 3,
+  Shl = 4,
+  Shr = 5,
+};
+
+enum class Cond : uint8_t {
+  O = 0x0,
+  B = 0x2,
+  AE = 0x3,
+  Z = 0x4,
+  NZ = 0x5,
+  S = 0x8,
+};
+
+using Label = int;
+
+/*
+  Just enough of an x86-64 assembler for the JIT. Memory operands are always
+  [base + disp32] or [base + index * scale], and 8-bit register operands are
+  limited to al, cl and dl so that no REX prefix changes their meaning.
+*/
+class X64Emitter {
+ public:
+  std::vector<uint8_t>& Finish();
+
+  Label NewLabel();
+  void Bind(Label label);
+  void Jmp(Label label);
+  void Jcc(Cond cond, Label label);
+  void Ret();
+
+  /* Loads and stores */
+  void MovImm32(Reg dst, uint32_t imm);
+  void Mov32(Reg dst, Reg src);
+  void Load32(Reg dst, Reg base, int32_t disp);
+  void Load64(Reg dst, Reg base, int32_t disp);
+  void Store32(Reg base, int32_t disp, Reg src);
+  void Store64(Reg base, int32_t disp, Reg src);
+  void Store32Indexed(Reg base, Reg index, uint8_t scale, Reg src);
+  void Movzx8(Reg dst, Reg base, int32_t disp);
+  void Movzx8Indexed(Reg dst, Reg base, Reg index);
+  void Movzx8Reg(Reg dst, Reg src);
+  void Store8(Reg base, int32_t disp, Reg src);
+  void Store8Indexed(Reg base, Reg index, Reg src);
+  void Store8Imm(Reg base, int32_t disp, uint8_t imm);
+  void Store16(Reg base, int32_t disp, Reg src);
+  void Store16Imm(Reg base, int32_t disp, uint16_t imm);
+
+  /* Arithmetic */
+  void Alu8(Alu op, Reg dst, Reg src);
+  void Alu8Imm(Alu op, Reg dst, uint8_t imm);
+  void Alu32(Alu op, Reg dst, Reg src);
+  void Alu32Imm(Alu op, Reg dst, int32_t imm);
+  void Alu32Mem(Alu op, Reg dst, Reg base, int32_t disp);
+  void Alu64Imm(Alu op, Reg dst, int32_t imm);
+  void Shift8(Shift op, Reg dst);
+  void Shl32(Reg dst, uint8_t count);
+  void Shr32(Reg dst, uint8_t count);
+  void Inc8(Reg dst);
+  void Dec8(Reg dst);
+  void Inc8Mem(Reg base, int32_t disp);
+  void Dec8Mem(Reg base, int32_t disp);
+  void Inc32(Reg dst);
+  void Test8(Reg a, Reg b);
+  void Test32Imm(Reg a, uint32_t imm);
+  void Setcc(Cond cond, Reg base, int32_t disp);
+
+ private:
+  void Rex(bool w, uint8_t reg, uint8_t index, uint8_t base);
+  void ModRmMem(uint8_t reg, Reg base, int32_t disp);
+  void ModRmIndexed(uint8_t reg, Reg base, Reg index, uint8_t scale);
+  void ModRmReg(uint8_t reg, Reg rm);
+  void Imm32(uint32_t imm);
+  void Rel32(Label label);
+
+  std::vector<uint8_t> code;
+  std::vector<int64_t> labels;
+  // (position of a rel32 field, label it refers to)
+  std::vector<std::pair<uint64_t, Label>> fixups;
+};
+
+}  // namespace cpu
+
+#endif  // SRC_CPU_X64_EMITTER_H_
@@ -0,0 +1,32 @@
+#ifndef SRC_EVENTS_EVENTS_H_
+#define SRC_EVENTS_EVENTS_H_
+
+#include <cstdint>
+
+namespace events {
+
+/*
+  Bits of the machine-wide pending-events word. Memory owns the word and
+  hands it to the PPU and APU, which set and clear their bits as things
+  happen; the CPU tests the whole word once per instruction instead of
+  asking every component in turn.
+*/
+constexpr uint32_t NMI = 1 << 0;
+constexpr uint32_t VBLANK = 1 << 1;
+constexpr uint32_t FRAME_IRQ = 1 << 2;
+constexpr uint32_t DMC_IRQ = 1 << 3;
+constexpr uint32_t AUDIO_BUFFER_FULL = 1 << 4;
+constexpr uint32_t OAM_DMA = 1 << 5;
+constexpr uint32_t DMC_STALL = 1 << 6;
+// set by the CPU when it hits a breakpoint or watchpoint
+constexpr uint32_t BREAKPOINT = 1 << 7;
+
+constexpr uint32_t IRQ = FRAME_IRQ | DMC_IRQ;
+
+inline void Set(uint32_t& pending, uint32_t bits, bool value) {
+  pending = value ? pending | bits : pending & ~bits;
+}
+
+}  // namespace events
+
+#endif  // SRC_EVENTS_EVENTS_H_
@@ -0,0 +1,48 @@
+#ifndef SRC_EVENTS_SCHEDULER_H_
+#define SRC_EVENTS_SCHEDULER_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace events {
+
+// Components that run on the scheduler. Mapper IRQ counters would get a
+// task of their own.
+constexpr int TASK_FRAME_SEQUENCER = 0;
+constexpr int TASK_DMC = 1;
+constexpr int TASKS = 2;
+
+constexpr uint64_t NEVER = UINT64_MAX;
+
+/*
+  The next cycle on which each component has something to do, such as the
+  APU frame sequencer reaching a step or the DMC timer running out. The
+  cycles in between are skipped. A component catches up on them when its
+  deadline comes round, or when a register access forces it to, and then
+  schedules its next deadline.
+*/
+class Scheduler {
+ public:
+  Scheduler() { deadlines.fill(NEVER); }
+
+  void Schedule(int task, uint64_t cycle) {
+    deadlines[task] = cycle;
+    next = *std::min_element(deadlines.begin(), deadlines.end());
+  }
+
+  uint64_t Deadline(int task) const { return deadlines[task]; }
+  // the earliest deadline of any task
+  uint64_t Next() const { return next; }
+
+  // APU cycles ticked so far
+  uint64_t now = 0;
+
+ private:
+  std::array<uint64_t, TASKS> deadlines;
+  uint64_t next = NEVER;
+};
+
+}  // namespace events
+
+#endif  // SRC_EVENTS_SCHEDULER_H_
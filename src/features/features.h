@@ -0,0 +1,54 @@
+#ifndef SRC_FEATURES_FEATURES_H_
+#define SRC_FEATURES_FEATURES_H_
+
+/*
+  Debugging facilities that can be compiled out of the emulation loop,
+  selected at build time:
+
+    NESEMU_FEATURES_LEAN  none of them, for production builds
+    (neither)             everything but the profiling counters and the
+                          RAM heatmap (default)
+    NESEMU_FEATURES_FULL  everything, including the profiling counters and
+                          the RAM heatmap
+
+  The policy is a constant, so the checks of a disabled facility fold away
+  and leave no branch behind. The define has to be the same for every
+  library in a build.
+*/
+#if defined(NESEMU_FEATURES_LEAN) && defined(NESEMU_FEATURES_FULL)
+#error "NESEMU_FEATURES_LEAN and NESEMU_FEATURES_FULL are exclusive"
+#endif
+
+namespace features {
+
+struct Policy {
+  // Cpu::StartTrace
+  bool trace;
+  // Cpu::SetBreakpoint and Cpu::StartCoverage
+  bool breakpoints;
+  // per-opcode counters and the guest sampler (src/cpu/profile.h)
+  bool profile;
+  // RAM access counters (src/memory/heatmap.h)
+  bool heatmap;
+  // PPU debug views refreshed as the game runs rather than when asked for
+  bool eager_debug_views;
+};
+
+constexpr Policy LEAN = {false, false, false, false, false};
+constexpr Policy DEFAULT = {true, true, false, false, true};
+constexpr Policy FULL = {true, true, true, true, true};
+
+#if defined(NESEMU_FEATURES_LEAN)
+constexpr Policy ENABLED = LEAN;
+constexpr const char* NAME = "lean";
+#elif defined(NESEMU_FEATURES_FULL)
+constexpr Policy ENABLED = FULL;
+constexpr const char* NAME = "full";
+#else
+constexpr Policy ENABLED = DEFAULT;
+constexpr const char* NAME = "default";
+#endif
+
+}  // namespace features
+
+#endif  // SRC_FEATURES_FEATURES_H_
@@ -0,0 +1,131 @@
+#include "cheats.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "src/mappers/mapper.h"
+
+namespace mappers {
+
+namespace {
+
+// Game Genie letters in order of the nibble they stand for
+constexpr char GAME_GENIE_LETTERS[] = "APZLGITYEOXUKSVN";
+
+Cheat ParseGameGenie(const std::string& code) {
+  uint8_t n[8];
+
+  for (uint64_t i = 0; i < code.size(); i++) {
+    const char* letter = std::strchr(
+        GAME_GENIE_LETTERS, std::toupper(static_cast<unsigned char>(code[i])));
+
+    if (letter == nullptr || *letter == '\0') {
+      throw "Invalid Game Genie code";
+    }
+
+    n[i] = static_cast<uint8_t>(letter - GAME_GENIE_LETTERS);
+  }
+
+  Cheat cheat = {};
+  cheat.addr = 0x8000 | ((n[3] & 7) << 12) | ((n[5] & 7) << 8) |
+               ((n[4] & 8) << 8) | ((n[2] & 7) << 4) | ((n[1] & 8) << 4) |
+               (n[4] & 7) | (n[3] & 8);
+  cheat.value = ((n[1] & 7) << 4) | ((n[0] & 8) << 4) | (n[0] & 7);
+
+  if (code.size() == 6) {
+    cheat.value |= n[5] & 8;
+  } else {
+    cheat.value |= n[7] & 8;
+    cheat.has_compare = true;
+    cheat.compare = ((n[7] & 7) << 4) | ((n[6] & 8) << 4) | (n[6] & 7) |
+                    (n[5] & 8);
+  }
+
+  return cheat;
+}
+
+// A hex field of a raw code, at most `digits` long.
+uint32_t ParseHex(const std::string& field, uint64_t digits) {
+  if (field.empty() || field.size() > digits ||
+      field.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+    throw "Invalid raw cheat code";
+  }
+
+  return std::stoul(field, nullptr, 16);
+}
+
+Cheat ParseRaw(const std::string& code) {
+  uint64_t first = code.find(':');
+  uint64_t second = code.find(':', first + 1);
+
+  Cheat cheat = {};
+  cheat.addr = ParseHex(code.substr(0, first), 4);
+
+  if (second == std::string::npos) {
+    cheat.value = ParseHex(code.substr(first + 1), 2);
+  } else {
+    cheat.value = ParseHex(code.substr(first + 1, second - first - 1), 2);
+    cheat.has_compare = true;
+    cheat.compare = ParseHex(code.substr(second + 1), 2);
+  }
+
+  if (cheat.addr < 0x8000) {
+    throw "Cheats can only patch 0x8000-0xFFFF";
+  }
+
+  return cheat;
+}
+
+}  // namespace
+
+Cheat ParseCheat(const std::string& code) {
+  if (code.find(':') != std::string::npos) {
+    return ParseRaw(code);
+  }
+
+  if (code.size() == 6 || code.size() == 8) {
+    return ParseGameGenie(code);
+  }
+
+  throw "Invalid cheat code";
+}
+
+void CheatOverlay::Add(const Cheat& cheat) {
+  cheats.push_back(cheat);
+  patched[cheat.addr >> 8];
+  positions.set(cheat.addr & 0xFFF);
+}
+
+void CheatOverlay::Clear() {
+  cheats.clear();
+  patched.clear();
+  positions.reset();
+}
+
+void CheatOverlay::Apply(CpuPages& pages) {
+  for (auto& [page, copy] : patched) {
+    const uint8_t* mapped = pages.read[page];
+
+    // pages that aren't published are read through the mapper, unpatched
+    if (mapped == nullptr || mapped == copy.data()) {
+      continue;
+    }
+
+    std::memcpy(copy.data(), mapped, CPU_PAGE_SIZE);
+
+    for (const Cheat& cheat : cheats) {
+      uint8_t offset = cheat.addr & 0xFF;
+
+      if ((cheat.addr >> 8) == page &&
+          (!cheat.has_compare || mapped[offset] == cheat.compare)) {
+        copy[offset] = cheat.value;
+      }
+    }
+
+    pages.read[page] = copy.data();
+  }
+}
+
+}  // namespace mappers
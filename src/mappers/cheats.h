@@ -0,0 +1,60 @@
+#ifndef SRC_MAPPERS_CHEATS_H_
+#define SRC_MAPPERS_CHEATS_H_
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mappers {
+
+struct CpuPages;
+
+// Patches the byte the CPU reads at addr (0x8000-0xFFFF) with value, only
+// while the byte mapped there is compare if has_compare is set.
+struct Cheat {
+  uint16_t addr;
+  uint8_t value;
+  bool has_compare;
+  uint8_t compare;
+};
+
+// Parses a Game Genie code (6 or 8 letters) or a raw code in hex, either
+// addr:value or addr:value:compare.
+Cheat ParseCheat(const std::string& code);
+
+/*
+  Cheats applied as copies of the 256-byte pages they patch. Publishing the
+  page table points those pages at the copies, refreshed from whichever
+  bank is mapped, so reads everywhere else keep going straight to PRG-ROM
+  and a compare is checked against the bank that is actually there.
+*/
+class CheatOverlay {
+ public:
+  void Add(const Cheat& cheat);
+  void Clear();
+
+  // Points the patched pages of `pages`, as just published, at patched
+  // copies of what they map.
+  void Apply(CpuPages& pages);
+
+  // True if addr is on a page read from a patched copy, which has to be
+  // refreshed when PRG-ROM under it is written.
+  bool Patches(uint16_t addr) { return patched.count(addr >> 8) > 0; }
+
+  // True if a cheat patches the same position of a 4K slot as addr. Code
+  // caches keyed by PRG-ROM offset leave such bytes alone.
+  bool Covers(uint16_t addr) { return positions.test(addr & 0xFFF); }
+
+ private:
+  std::vector<Cheat> cheats;
+  // patched copy of every page with a cheat, by page number
+  std::map<uint8_t, std::array<uint8_t, 0x100>> patched;
+  std::bitset<0x1000> positions;
+};
+
+}  // namespace mappers
+
+#endif  // SRC_MAPPERS_CHEATS_H_
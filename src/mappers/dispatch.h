@@ -0,0 +1,50 @@
+#ifndef SRC_MAPPERS_DISPATCH_H_
+#define SRC_MAPPERS_DISPATCH_H_
+
+#include <cstdint>
+
+#include "src/mappers/mapper.h"
+#include "src/mappers/nrom.h"
+#include "src/mappers/uxrom.h"
+
+/*
+  The cartridge is picked once, by ReadCartridge, but is accessed several
+  times per tile the PPU fetches. Going through Dispatch instead of the
+  virtual methods turns each access into a well-predicted switch on the
+  mapper's kind followed by an inlined call on the concrete type.
+*/
+namespace mappers {
+
+// Calls f with the mapper downcast to its concrete type.
+template <typename F>
+inline decltype(auto) Dispatch(Mapper& mapper, F&& f) {
+  switch (mapper.kind) {
+    case MapperKind::Nrom:
+      return f(static_cast<Nrom&>(mapper));
+    case MapperKind::UxRom:
+      return f(static_cast<UxRom&>(mapper));
+  }
+
+  // every MapperKind is handled above
+  __builtin_unreachable();
+}
+
+inline uint8_t CpuRead(Mapper& mapper, uint16_t addr) {
+  return Dispatch(mapper, [addr](auto& m) { return m.CpuRead(addr); });
+}
+
+inline void CpuWrite(Mapper& mapper, uint16_t addr, uint8_t value) {
+  Dispatch(mapper, [addr, value](auto& m) { m.CpuWrite(addr, value); });
+}
+
+inline uint8_t PpuRead(Mapper& mapper, uint16_t addr) {
+  return Dispatch(mapper, [addr](auto& m) { return m.PpuRead(addr); });
+}
+
+inline void PpuWrite(Mapper& mapper, uint16_t addr, uint8_t value) {
+  Dispatch(mapper, [addr, value](auto& m) { m.PpuWrite(addr, value); });
+}
+
+}  // namespace mappers
+
+#endif  // SRC_MAPPERS_DISPATCH_H_
@@ -1,17 +1,112 @@
 #ifndef SRC_MAPPERS_MAPPER_H_
 #define SRC_MAPPERS_MAPPER_H_
 
+#include <array>
 #include <cstdint>
+#include <vector>
+
+#include "src/mappers/cheats.h"
 
 namespace mappers {
 
+constexpr int CPU_PAGE_SIZE = 0x100;
+// writes to PRG-ROM whose offsets are remembered, see Mapper::prg_rom_written
+constexpr uint64_t PRG_ROM_WRITE_LOG = 64;
+// logged in place of an offset when all of PRG-ROM has to be treated as
+// written
+constexpr uint64_t PRG_ROM_ALL = UINT64_MAX;
+
+/*
+  Host memory behind each 256-byte page of the CPU address space, for pages
+  that can be read or written without side effects. Accesses to a nullptr
+  page go through the memory map's handlers instead.
+*/
+struct CpuPages {
+  std::array<uint8_t*, 256> read = {};
+  std::array<uint8_t*, 256> write = {};
+};
+
+// Every concrete mapper, see Dispatch in src/mappers/dispatch.h.
+enum class MapperKind {
+  Nrom,
+  UxRom,
+};
+
 class Mapper {
  public:
+  explicit Mapper(MapperKind kind) : kind(kind) {}
+
   virtual uint8_t CpuRead(uint16_t addr) = 0;
   virtual void CpuWrite(uint16_t addr, uint8_t value) = 0;
   virtual uint8_t PpuRead(uint16_t addr) = 0;
   virtual void PpuWrite(uint16_t addr, uint8_t value) = 0;
+  // PRG-ROM offset that CPU address addr (0x8000-0xFFFF) currently maps to.
+  virtual uint64_t PrgRomOffset(uint16_t addr) = 0;
+  virtual uint64_t PrgRomSize() = 0;
   virtual ~Mapper() {}
+
+  // Publishes the cartridge's memory into `pages`, and keeps it published
+  // across bank switches.
+  void AttachPages(CpuPages* pages) {
+    cpu_pages = pages;
+    PublishPages();
+  }
+
+  // Cheats patch what the CPU reads from PRG-ROM through the page table
+  // (see cheats.h); CpuRead itself is never patched. Changing them counts as
+  // a write to all of PRG-ROM, so that code decoded from it is dropped.
+  void AddCheat(const Cheat& cheat) {
+    cheats.Add(cheat);
+    RecordPrgRomWrite(PRG_ROM_ALL);
+    PublishPages();
+  }
+  void ClearCheats() {
+    cheats.Clear();
+    RecordPrgRomWrite(PRG_ROM_ALL);
+    PublishPages();
+  }
+  bool MayBeCheated(uint16_t addr) { return cheats.Covers(addr); }
+
+  const MapperKind kind;
+
+  // Bumped whenever the CPU's view of PRG-ROM changes, so that anything
+  // derived from it (e.g. the CPU's decode cache) can be refreshed.
+  uint64_t bank_switches = 0;
+  uint64_t prg_rom_writes = 0;
+  // PRG-ROM offset of the last PRG_ROM_WRITE_LOG writes, write n at
+  // n % PRG_ROM_WRITE_LOG, so that only what was derived from those bytes
+  // has to go
+  std::array<uint64_t, PRG_ROM_WRITE_LOG> prg_rom_written = {};
+
+ protected:
+  void RecordPrgRomWrite(uint64_t offset) {
+    prg_rom_written[prg_rom_writes % PRG_ROM_WRITE_LOG] = offset;
+    prg_rom_writes++;
+  }
+
+  // Points the pages of 0x4020-0xFFFF at the current banks. Has to be called
+  // again whenever those change.
+  virtual void PublishPages() {}
+
+  // Pages of 0x8000-0xFFFF as mapped by PrgRomOffset, read-only so that
+  // writes still reach CpuWrite.
+  void PublishPrgRom(std::vector<uint8_t>& prg_rom) {
+    if (cpu_pages == nullptr) {
+      return;
+    }
+
+    for (int page = 0x80; page <= 0xFF; page++) {
+      uint64_t offset = PrgRomOffset(page * CPU_PAGE_SIZE);
+      cpu_pages->read[page] = offset + CPU_PAGE_SIZE <= prg_rom.size()
+                                  ? prg_rom.data() + offset
+                                  : nullptr;
+    }
+
+    cheats.Apply(*cpu_pages);
+  }
+
+  CpuPages* cpu_pages = nullptr;
+  CheatOverlay cheats;
 };
 
 }  // namespace mappers
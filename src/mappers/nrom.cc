@@ -12,7 +12,8 @@
 namespace mappers {
 
 Nrom::Nrom(INesHeader header, std::vector<uint8_t> data)
-    : nrom256(header.prg_rom_size == 32 * 1024),
+    : Mapper(MapperKind::Nrom),
+      nrom256(header.prg_rom_size == 32 * 1024),
       prg_ram(),
       vram(),
       mirroring(header.mirroring) {
@@ -34,39 +35,21 @@ Nrom::Nrom(INesHeader header, std::vector<uint8_t> data)
   std::cout << "vram: " << vram.size() << std::endl;
 }
 
-uint8_t Nrom::CpuRead(uint16_t addr) {
-  if (addr < 0x6000) {
-    return 0x00;
-  } else if (addr <= 0x7FFF) {
-    return prg_ram[addr - 0x6000];
-  } else if (addr <= 0xFFFF) {
-    return prg_rom[nrom256 ? (addr - 0x8000) : (addr - 0x8000) % 0x4000];
-  } else {
-    return 0x00;
-  }
-}
-
 void Nrom::CpuWrite(uint16_t addr, uint8_t value) {
   if (addr < 0x6000) {
     return;
   } else if (addr <= 0x7FFF) {
     prg_ram[addr - 0x6000] = value;
   } else if (addr <= 0xFFFF) {
-    prg_rom[nrom256 ? (addr - 0x8000) : (addr - 0x8000) % 0x4000] = value;
-  } else {
-    return;
-  }
-}
+    uint64_t offset = PrgRomOffset(addr);
+    prg_rom[offset] = value;
+    RecordPrgRomWrite(offset);
 
-uint8_t Nrom::PpuRead(uint16_t addr) {
-  if (addr <= 0x1FFF) {
-    return chr_rxm[addr];
-  } else if (addr <= 0x2FFF) {
-    return VramRead(addr);
-  } else if (addr <= 0x3FFF) {
-    return VramRead(addr - 0x1000);
+    if (cheats.Patches(addr)) {
+      PublishPages();
+    }
   } else {
-    return 0x00;
+    return;
   }
 }
 
@@ -82,14 +65,19 @@ void Nrom::PpuWrite(uint16_t addr, uint8_t value) {
   }
 }
 
-uint8_t Nrom::VramRead(uint16_t addr) {
-  switch (mirroring) {
-    case graphics::Mirroring::Horizontal: {
-      return vram[graphics::horizontal_mirrored(addr)];
-    }
-    case graphics::Mirroring::Vertical: {
-      return vram[graphics::vertical_mirrored(addr)];
-    }
+uint64_t Nrom::PrgRomSize() { return prg_rom.size(); }
+
+void Nrom::PublishPages() {
+  PublishPrgRom(prg_rom);
+
+  if (cpu_pages == nullptr) {
+    return;
+  }
+
+  for (int page = 0x60; page <= 0x7F; page++) {
+    uint8_t* data = prg_ram.data() + (page - 0x60) * CPU_PAGE_SIZE;
+    cpu_pages->read[page] = data;
+    cpu_pages->write[page] = data;
   }
 }
 
@@ -11,7 +11,7 @@
 
 namespace mappers {
 
-class Nrom : public Mapper {
+class Nrom final : public Mapper {
  public:
   Nrom(INesHeader header, std::vector<uint8_t> data);
 
@@ -19,6 +19,11 @@ class Nrom : public Mapper {
   void CpuWrite(uint16_t addr, uint8_t value) override;
   uint8_t PpuRead(uint16_t addr) override;
   void PpuWrite(uint16_t addr, uint8_t value) override;
+  uint64_t PrgRomOffset(uint16_t addr) override;
+  uint64_t PrgRomSize() override;
+
+ protected:
+  void PublishPages() override;
 
  private:
   uint8_t VramRead(uint16_t addr);
@@ -32,6 +37,47 @@ class Nrom : public Mapper {
   graphics::Mirroring mirroring;
 };
 
+// Inline so that accesses through Dispatch (src/mappers/dispatch.h) can
+// be compiled into the PPU and memory map.
+inline uint8_t Nrom::CpuRead(uint16_t addr) {
+  if (addr < 0x6000) {
+    return 0x00;
+  } else if (addr <= 0x7FFF) {
+    return prg_ram[addr - 0x6000];
+  } else if (addr <= 0xFFFF) {
+    return prg_rom[PrgRomOffset(addr)];
+  } else {
+    return 0x00;
+  }
+}
+
+inline uint8_t Nrom::PpuRead(uint16_t addr) {
+  if (addr <= 0x1FFF) {
+    return chr_rxm[addr];
+  } else if (addr <= 0x2FFF) {
+    return VramRead(addr);
+  } else if (addr <= 0x3FFF) {
+    return VramRead(addr - 0x1000);
+  } else {
+    return 0x00;
+  }
+}
+
+inline uint64_t Nrom::PrgRomOffset(uint16_t addr) {
+  return nrom256 ? (addr - 0x8000) : (addr - 0x8000) % 0x4000;
+}
+
+inline uint8_t Nrom::VramRead(uint16_t addr) {
+  switch (mirroring) {
+    case graphics::Mirroring::Horizontal: {
+      return vram[graphics::horizontal_mirrored(addr)];
+    }
+    case graphics::Mirroring::Vertical: {
+      return vram[graphics::vertical_mirrored(addr)];
+    }
+  }
+}
+
 }  // namespace mappers
 
 #endif  // SRC_MAPPERS_NROM_H_
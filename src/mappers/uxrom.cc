@@ -3,7 +3,11 @@
 namespace mappers {
 
 UxRom::UxRom(INesHeader header, std::vector<uint8_t> data)
-    : prg_rom(), chr_rxm(), vram(), mirroring(header.mirroring) {
+    : Mapper(MapperKind::UxRom),
+      prg_rom(),
+      chr_rxm(),
+      vram(),
+      mirroring(header.mirroring) {
   if (header.prg_rom_size % BANK_SIZE != 0) {
     throw "INES ROM size not a multiple of 16K";
   }
@@ -27,33 +31,11 @@ UxRom::UxRom(INesHeader header, std::vector<uint8_t> data)
   std::cout << "vram: " << vram.size() << std::endl;
 }
 
-uint8_t UxRom::CpuRead(uint16_t addr) {
-  if (addr < 0x8000) {
-    return 0x00;
-  } else if (addr <= 0xBFFF) {
-    return prg_rom[bank * BANK_SIZE + (addr - 0x8000)];
-  } else if (addr <= 0xFFFF) {
-    return prg_rom[(num_banks - 1) * BANK_SIZE + (addr - 0xC000)];
-  } else {
-    return 0x00;
-  }
-}
-
 void UxRom::CpuWrite(uint16_t addr, uint8_t value) {
   if (addr >= 0x8000) {
     bank = static_cast<uint16_t>(value & 0xF);
-  }
-}
-
-uint8_t UxRom::PpuRead(uint16_t addr) {
-  if (addr <= 0x1FFF) {
-    return chr_rxm[addr];
-  } else if (addr <= 0x2FFF) {
-    return VramRead(addr);
-  } else if (addr <= 0x3FFF) {
-    return VramRead(addr - 0x1000);
-  } else {
-    return 0x00;
+    bank_switches++;
+    PublishPages();
   }
 }
 
@@ -69,16 +51,7 @@ void UxRom::PpuWrite(uint16_t addr, uint8_t value) {
   }
 }
 
-uint8_t UxRom::VramRead(uint16_t addr) {
-  switch (mirroring) {
-    case graphics::Mirroring::Horizontal: {
-      return vram[graphics::horizontal_mirrored(addr)];
-    }
-    case graphics::Mirroring::Vertical: {
-      return vram[graphics::vertical_mirrored(addr)];
-    }
-  }
-}
+uint64_t UxRom::PrgRomSize() { return prg_rom.size(); }
 
 void UxRom::VramWrite(uint16_t addr, uint8_t value) {
   switch (mirroring) {
@@ -17,7 +17,7 @@ constexpr int BANK_SIZE = 16 * 1024;
 
 }  // namespace
 
-class UxRom : public Mapper {
+class UxRom final : public Mapper {
  public:
   UxRom(INesHeader header, std::vector<uint8_t> data);
 
@@ -25,6 +25,11 @@ class UxRom : public Mapper {
   void CpuWrite(uint16_t addr, uint8_t value) override;
   uint8_t PpuRead(uint16_t addr) override;
   void PpuWrite(uint16_t addr, uint8_t value) override;
+  uint64_t PrgRomOffset(uint16_t addr) override;
+  uint64_t PrgRomSize() override;
+
+ protected:
+  void PublishPages() override { PublishPrgRom(prg_rom); }
 
  private:
   uint8_t VramRead(uint16_t addr);
@@ -38,6 +43,48 @@ class UxRom : public Mapper {
   uint16_t bank = 0;
 };
 
+// Inline for Dispatch, see nrom.h.
+inline uint8_t UxRom::CpuRead(uint16_t addr) {
+  if (addr < 0x8000) {
+    return 0x00;
+  } else if (addr <= 0xFFFF) {
+    return prg_rom[PrgRomOffset(addr)];
+  } else {
+    return 0x00;
+  }
+}
+
+inline uint8_t UxRom::PpuRead(uint16_t addr) {
+  if (addr <= 0x1FFF) {
+    return chr_rxm[addr];
+  } else if (addr <= 0x2FFF) {
+    return VramRead(addr);
+  } else if (addr <= 0x3FFF) {
+    return VramRead(addr - 0x1000);
+  } else {
+    return 0x00;
+  }
+}
+
+inline uint64_t UxRom::PrgRomOffset(uint16_t addr) {
+  if (addr <= 0xBFFF) {
+    return bank * BANK_SIZE + (addr - 0x8000);
+  } else {
+    return (num_banks - 1) * BANK_SIZE + (addr - 0xC000);
+  }
+}
+
+inline uint8_t UxRom::VramRead(uint16_t addr) {
+  switch (mirroring) {
+    case graphics::Mirroring::Horizontal: {
+      return vram[graphics::horizontal_mirrored(addr)];
+    }
+    case graphics::Mirroring::Vertical: {
+      return vram[graphics::vertical_mirrored(addr)];
+    }
+  }
+}
+
 }  // namespace mappers
 
 #endif  // SRC_MAPPERS_UXROM_H_
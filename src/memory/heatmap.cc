@@ -0,0 +1,37 @@
+#include "heatmap.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace memory {
+
+Heatmap::Heatmap(const std::string& path)
+    : file(std::fopen(path.c_str(), "wb")) {
+  if (file == nullptr) {
+    throw "Could not open heatmap file";
+  }
+
+  std::fwrite(HEATMAP_MAGIC, sizeof(HEATMAP_MAGIC), 1, file);
+}
+
+Heatmap::~Heatmap() { std::fclose(file); }
+
+void Heatmap::EndFrame() {
+  uint16_t count = 0;
+
+  for (int i = 0; i < WORK_RAM_SIZE; i++) {
+    if (reads[i] > 0 || writes[i] > 0) {
+      entries[count++] = {static_cast<uint16_t>(i), reads[i], writes[i]};
+    }
+  }
+
+  HeatmapFrame header = {frame++, count, 0};
+  std::fwrite(&header, sizeof(header), 1, file);
+  std::fwrite(entries.data(), sizeof(HeatmapEntry), count, file);
+
+  reads.fill(0);
+  writes.fill(0);
+}
+
+}  // namespace memory
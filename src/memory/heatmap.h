@@ -0,0 +1,70 @@
+#ifndef SRC_MEMORY_HEATMAP_H_
+#define SRC_MEMORY_HEATMAP_H_
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "src/memory/work_ram.h"
+
+namespace memory {
+
+// first bytes of a heatmap file, followed by one HeatmapFrame per frame
+constexpr char HEATMAP_MAGIC[8] = {'N', 'E', 'S', 'H', 'E', 'A', 'T', '1'};
+
+// Starts a frame's record, followed by `entries` HeatmapEntries.
+struct HeatmapFrame {
+  uint32_t frame;
+  uint16_t entries;
+  uint16_t unused;
+};
+
+// Accesses to one work RAM index (see work_ram.h) in a frame. A frame is
+// well under 65536 CPU cycles, so 16 bits can't overflow.
+struct HeatmapEntry {
+  uint16_t index;
+  uint16_t reads;
+  uint16_t writes;
+};
+
+static_assert(sizeof(HeatmapFrame) == 8);
+static_assert(sizeof(HeatmapEntry) == 6);
+
+/*
+  Reads and writes of every work RAM address, counted over a frame.
+  EndFrame writes the counters that moved and starts the next frame, so the
+  file holds one sparse snapshot per frame.
+*/
+class Heatmap {
+ public:
+  Heatmap(const std::string& path);
+  ~Heatmap();
+
+  void Read(uint16_t addr) {
+    int index = WorkRamIndex(addr);
+    if (index >= 0) {
+      reads[index]++;
+    }
+  }
+
+  void Write(uint16_t addr) {
+    int index = WorkRamIndex(addr);
+    if (index >= 0) {
+      writes[index]++;
+    }
+  }
+
+  void EndFrame();
+
+ private:
+  std::FILE* file;
+  uint32_t frame = 0;
+  std::array<uint16_t, WORK_RAM_SIZE> reads = {};
+  std::array<uint16_t, WORK_RAM_SIZE> writes = {};
+  std::array<HeatmapEntry, WORK_RAM_SIZE> entries;
+};
+
+}  // namespace memory
+
+#endif  // SRC_MEMORY_HEATMAP_H_
@@ -1,23 +1,44 @@
 #include "memory.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <memory>
 
+#include "src/features/features.h"
 #include "src/mappers/ines.h"
+#include "src/mappers/dispatch.h"
 #include "src/mappers/mapper.h"
 
 namespace memory {
 
 Memory::Memory(const std::string& path, uint8_t& p1_input)
     : cartridge(mappers::ReadCartridge(path)),
-      ppu(cartridge),
+      ppu(cartridge, pending),
       ram(),
       p1_input(p1_input),
-      apu(cartridge) {
+      apu(cartridge, pending, scheduler) {
   for (int i = 0; i < ram.size(); i++) {
     ram[i] = 0x00;
   }
+
+  for (int page = 0; page < handlers.size(); page++) {
+    if (page <= 0x1F) {
+      handlers[page] = PageHandler::Ram;
+      // 0x0800-0x1FFF mirror the 2K of RAM
+      pages.read[page] = ram.data() + (page & 0x7) * mappers::CPU_PAGE_SIZE;
+      pages.write[page] = pages.read[page];
+    } else if (page <= 0x3F) {
+      handlers[page] = PageHandler::Ppu;
+    } else if (page == 0x40) {
+      handlers[page] = PageHandler::Io;
+    } else {
+      handlers[page] = PageHandler::Cartridge;
+    }
+  }
+
+  cartridge->AttachPages(&pages);
+  ppu_quiet = ppu.VblankDots();
 }
 
 void Memory::DmaTick() {
@@ -28,31 +49,100 @@ void Memory::DmaTick() {
       return;
     }
     case DmaState::Write: {
+      SyncPpu();
       ppu.OamDmaWrite(dma_data);
       dma_addr++;
       dma_state = DmaState::Read;
       if ((dma_addr & 0xFF) == 0) {
-        in_dma = false;
-        ppu.UpdateSprites();
+        pending &= ~events::OAM_DMA;
+
+        if constexpr (features::ENABLED.eager_debug_views) {
+          ppu.UpdateSprites();
+        }
       }
       return;
     }
   }
 }
 
-uint8_t* Memory::GetScreen() { return ppu.screen.data(); }
+bool Memory::BulkDma() {
+  SyncPpu();
+  uint8_t* page = pages.read[dma_addr >> 8];
+
+  if (page == nullptr || dma_state != DmaState::Read ||
+      (dma_addr & 0xFF) != 0 || ppu.QuietDots() < 3 * OAM_DMA_CYCLES ||
+      apu.QuietCycles() < OAM_DMA_CYCLES) {
+    return false;
+  }
+
+  ppu.OamDmaCopy(page);
+  pending &= ~events::OAM_DMA;
+
+  for (int i = 0; i < 0x100; i++) {
+    CountRead(dma_addr + i);
+  }
+
+  if constexpr (features::ENABLED.eager_debug_views) {
+    ppu.UpdateSprites();
+  }
+
+  return true;
+}
+
+uint64_t Memory::QuietCycles(bool polls_status) {
+  // the PPU is ppu_debt dots behind
+  uint64_t dots = polls_status ? ppu.StatusDots() : ppu.VblankDots();
+  uint64_t ppu_cycles = dots > ppu_debt ? (dots - ppu_debt) / 3 : 0;
+  // the DMC's deadlines can't raise anything while the APU is quiet, but
+  // the frame sequencer's can raise an IRQ
+  uint64_t next = scheduler.Deadline(events::TASK_FRAME_SEQUENCER);
+  uint64_t sequencer_cycles = next > scheduler.now ? next - scheduler.now : 0;
+
+  return std::min({ppu_cycles, sequencer_cycles, apu.QuietCycles()});
+}
+
+void Memory::SnapshotWorkRam(WorkRam& snapshot) {
+  std::copy(ram.begin(), ram.end(), snapshot.begin());
+
+  for (int page = 0x60; page <= 0x7F; page++) {
+    uint8_t* data = pages.read[page];
+    uint8_t* copy = snapshot.data() + WORK_RAM_INTERNAL +
+                    (page - 0x60) * mappers::CPU_PAGE_SIZE;
+
+    if (data != nullptr) {
+      std::copy(data, data + mappers::CPU_PAGE_SIZE, copy);
+    } else {
+      std::fill(copy, copy + mappers::CPU_PAGE_SIZE, 0);
+    }
+  }
+}
+
+void Memory::PublishSharedState(const SharedRegisters& registers,
+                                uint64_t cycles) {
+  SyncPpu();
+  shared_state->Publish(registers, cycles, ppu.screen.data(), ram.data(),
+                        ppu.Oam(), ppu.PaletteRam());
+}
+
+uint8_t* Memory::GetScreen() {
+  SyncPpu();
+  return ppu.screen.data();
+}
 
 uint8_t* Memory::GetPatTable1() {
+  SyncPpu();
   ppu.UpdatePatternTable();
   return ppu.pat_table1.data();
 }
 
 uint8_t* Memory::GetPatTable2() {
+  SyncPpu();
   ppu.UpdatePatternTable(0x1000);
   return ppu.pat_table2.data();
 }
 
 uint8_t* Memory::GetNametable(uint16_t addr) {
+  SyncPpu();
   ppu.UpdateNametable(addr);
 
   switch (addr) {
@@ -67,21 +157,42 @@ uint8_t* Memory::GetNametable(uint16_t addr) {
   }
 }
 
-uint8_t* Memory::GetSprites() { return ppu.sprites.data(); }
+uint8_t* Memory::GetSprites() {
+  SyncPpu();
+
+  if constexpr (!features::ENABLED.eager_debug_views) {
+    ppu.UpdateSprites();
+  }
+
+  return ppu.sprites.data();
+}
 
 uint8_t* Memory::GetPalettes() {
+  SyncPpu();
   ppu.UpdatePalettes();
   return ppu.palettes.data();
 }
 
-uint8_t Memory::Read(uint16_t addr) {
-  if (addr <= 0x1FFF) {
-    return ram[addr % 0x800];
-  } else if (addr <= 0x2007) {
-    return ppu.Read(addr);
-  } else if (addr <= 0x3FFF) {
-    return ppu.Read(0x2000 | ((addr - 0x2000) & 0x7));
-  } else if (addr <= 0x4013) {
+uint8_t Memory::HandleRead(uint16_t addr) {
+  switch (handlers[addr >> 8]) {
+    case PageHandler::Ram:
+      return ram[addr % 0x800];
+    case PageHandler::Ppu:
+      SyncPpu();
+      return ppu.Read(0x2000 | (addr & 0x7));
+    case PageHandler::Io:
+      return addr <= 0x401F ? ReadIo(addr)
+                            : mappers::CpuRead(*cartridge, addr);
+    case PageHandler::Cartridge:
+      return mappers::CpuRead(*cartridge, addr);
+  }
+
+  // every PageHandler is handled above
+  __builtin_unreachable();
+}
+
+uint8_t Memory::ReadIo(uint16_t addr) {
+  if (addr <= 0x4013) {
     return apu.Read(addr);
   } else if (addr <= 0x4017) {
     switch (addr) {
@@ -98,29 +209,53 @@ uint8_t Memory::Read(uint16_t addr) {
       default:
         return 0x00;
     }
-  } else if (addr <= 0x401F) {
+  } else {
     // TODO
     return 0x00;
-  } else if (addr <= 0xFFFF) {
-    return cartridge->CpuRead(addr);
+  }
+}
+
+uint8_t Memory::Peek(uint16_t addr) {
+  if (uint8_t* page = pages.read[addr >> 8]) {
+    return page[addr & 0xFF];
+  } else if (addr >= 0x4020) {
+    return mappers::CpuRead(*cartridge, addr);
   } else {
     return 0x00;
   }
 }
 
-void Memory::Write(uint16_t addr, uint8_t value) {
-  if (addr <= 0x1FFF) {
-    ram[addr % 0x800] = value;
-  } else if (addr <= 0x2007) {
-    ppu.Write(addr, value);
-  } else if (addr <= 0x3FFF) {
-    ppu.Write(0x2000 | ((addr - 0x2000) & 0x7), value);
-  } else if (addr <= 0x4013) {
+void Memory::HandleWrite(uint16_t addr, uint8_t value) {
+  switch (handlers[addr >> 8]) {
+    case PageHandler::Ram:
+      ram[addr % 0x800] = value;
+      return;
+    case PageHandler::Ppu:
+      SyncPpu();
+      ppu.Write(0x2000 | (addr & 0x7), value);
+      return;
+    case PageHandler::Io:
+      if (addr <= 0x401F) {
+        WriteIo(addr, value);
+      } else {
+        SyncPpu();
+        mappers::CpuWrite(*cartridge, addr, value);
+      }
+      return;
+    case PageHandler::Cartridge:
+      SyncPpu();
+      mappers::CpuWrite(*cartridge, addr, value);
+      return;
+  }
+}
+
+void Memory::WriteIo(uint16_t addr, uint8_t value) {
+  if (addr <= 0x4013) {
     apu.Write(addr, value);
   } else if (addr <= 0x4017) {
     switch (addr) {
       case 0x4014: {
-        in_dma = true;
+        pending |= events::OAM_DMA;
         dma_state = DmaState::Read;
         dma_addr = static_cast<uint16_t>(value) << 8;
         break;
@@ -139,10 +274,8 @@ void Memory::Write(uint16_t addr, uint8_t value) {
         apu.Write(addr, value);
         break;
     }
-  } else if (addr <= 0x401F) {
+  } else {
     // TODO
-  } else if (addr <= 0xFFFF) {
-    return cartridge->CpuWrite(addr, value);
   }
 }
 
@@ -7,12 +7,37 @@
 #include <string>
 
 #include "src/apu/apu.h"
+#include "src/events/events.h"
+#include "src/events/scheduler.h"
+#include "src/features/features.h"
 #include "src/mappers/ines.h"
 #include "src/mappers/mapper.h"
+#include "src/memory/heatmap.h"
+#include "src/memory/shared_state.h"
+#include "src/memory/work_ram.h"
 #include "src/ppu/ppu.h"
 
 namespace memory {
 
+// Handles accesses to a page that isn't published in the page table.
+enum class PageHandler : uint8_t {
+  Ram,
+  Ppu,
+  // APU, controllers and OAM DMA below 0x4020, cartridge above
+  Io,
+  Cartridge,
+};
+
+enum class PpuSync {
+  // ticked along with every CPU cycle
+  Eager,
+  // only ticked once something could tell, see Memory::PpuTick
+  Lazy,
+};
+
+// CPU cycles an OAM DMA spends copying, after any alignment cycles
+constexpr uint64_t OAM_DMA_CYCLES = 512;
+
 enum class DmaState {
   Read,
   Write,
@@ -21,8 +46,20 @@ enum class DmaState {
 class Memory {
  public:
   Memory(const std::string& path, uint8_t& p1_input);
+  // the page table and the mapper point into this object
+  Memory(const Memory&) = delete;
+  Memory& operator=(const Memory&) = delete;
 
   void DmaTick();
+  // Runs a whole OAM DMA at once, if nothing could see it being done a byte
+  // at a time: the page has to be in the page table, and the PPU and APU
+  // have to be quiet for OAM_DMA_CYCLES. The caller then owes them those
+  // cycles. Returns false, having done nothing, otherwise.
+  bool BulkDma();
+  // A lower bound on the cycles that can pass before VBlank, a DMC stall,
+  // a full audio buffer or a scheduler deadline, and, if polls_status,
+  // before a PPUSTATUS read could return anything else.
+  uint64_t QuietCycles(bool polls_status);
 
   uint8_t* GetScreen();
   uint8_t* GetPatTable1();
@@ -31,18 +68,87 @@ class Memory {
   uint8_t* GetSprites();
   uint8_t* GetPalettes();
 
-  uint8_t Read(uint16_t addr);
-  void Write(uint16_t addr, uint8_t value);
+  // RAM, PRG-RAM and PRG-ROM are a single load through the page table; the
+  // rest goes to the page's handler.
+  uint8_t Read(uint16_t addr) {
+    CountRead(addr);
+    uint8_t* page = pages.read[addr >> 8];
+    return page != nullptr ? page[addr & 0xFF] : HandleRead(addr);
+  }
+
+  void Write(uint16_t addr, uint8_t value) {
+    CountWrite(addr);
+    uint8_t* page = pages.write[addr >> 8];
+    if (page != nullptr) {
+      page[addr & 0xFF] = value;
+    } else {
+      HandleWrite(addr, value);
+    }
+  }
+
+  // True if reading addr has no side effects, i.e. it is on a page that is
+  // read straight from the page table.
+  bool SideEffectFree(uint16_t addr) {
+    return pages.read[addr >> 8] != nullptr;
+  }
+  // For accesses to internal RAM that don't go through Read and Write.
+  void CountRead(uint16_t addr) {
+    if constexpr (features::ENABLED.heatmap) {
+      if (heatmap != nullptr) {
+        heatmap->Read(addr);
+      }
+    }
+  }
+  void CountWrite(uint16_t addr) {
+    if constexpr (features::ENABLED.heatmap) {
+      if (heatmap != nullptr) {
+        heatmap->Write(addr);
+      }
+    }
+  }
+  // Counts RAM and PRG-RAM accesses into a heatmap file, one snapshot per
+  // EndHeatmapFrame, until StopHeatmap.
+  void StartHeatmap(const std::string& path) {
+    heatmap = std::make_unique<Heatmap>(path);
+  }
+  void StopHeatmap() { heatmap.reset(); }
+  bool HeatmapRunning() {
+    return features::ENABLED.heatmap && heatmap != nullptr;
+  }
+  void EndHeatmapFrame() {
+    if (HeatmapRunning()) {
+      heatmap->EndFrame();
+    }
+  }
+  // Exports the machine to a POSIX shared memory object at every
+  // PublishSharedState, see shared_state.h.
+  void StartSharedState(const std::string& name) {
+    shared_state = std::make_unique<SharedState>(name);
+  }
+  void StopSharedState() { shared_state.reset(); }
+  bool SharingState() { return shared_state != nullptr; }
+  void PublishSharedState(const SharedRegisters& registers, uint64_t cycles);
+  // Copies internal RAM and PRG-RAM (zeros if the cartridge has none).
+  void SnapshotWorkRam(WorkRam& snapshot);
+  // Read without side effects, for debugging. Registers read as 0.
+  uint8_t Peek(uint16_t addr);
+
+  // see src/events/events.h
+  uint32_t Pending() { return pending; }
 
   bool NmiPending() { return ppu.NmiOccured(); }
 
   void ClearNmi() { ppu.ClearNmi(); }
 
-  bool InDma() { return in_dma; }
+  bool InDma() { return static_cast<bool>(pending & events::OAM_DMA); }
 
-  bool VblankEvent() { return ppu.vblank_event; }
+  bool VblankEvent() { return static_cast<bool>(pending & events::VBLANK); }
 
-  void ClearVBlankEvent() { ppu.vblank_event = false; }
+  void ClearVBlankEvent() { pending &= ~events::VBLANK; }
+
+  void SetBreakpointEvent(bool value) {
+    events::Set(pending, events::BREAKPOINT, value);
+  }
 
   bool IrqPending() { return apu.IrQPending(); }
 
@@ -50,18 +156,81 @@ class Memory {
 
   void UseFceuxPalette() { ppu.UseFceuxPalette(); }
   void UseNtscPalette() { ppu.UseNtscPalette(); }
-  void PpuTick(uint64_t n) { ppu.Tick(n); }
+  /*
+    A lazy PPU owes the dots it was ticked since it last ran, and runs them
+    when the CPU touches it or the PPU registers, or a mapper (which could
+    switch CHR banks), or when it could otherwise be about to raise VBlank.
+    OAM DMA and the frontend's views of the PPU catch it up as well. Both
+    modes produce identical output; eager is kept for comparison.
+  */
+  void PpuTick(uint64_t n) {
+    if (ppu_sync == PpuSync::Eager) {
+      ppu.Tick(n);
+      return;
+    }
+
+    ppu_debt += n;
+
+    if (ppu_debt > ppu_quiet) {
+      SyncPpu();
+    }
+  }
+
+  void SyncPpu() {
+    if (ppu_debt > 0) {
+      ppu.Tick(ppu_debt);
+      ppu_debt = 0;
+      ppu_quiet = ppu.VblankDots();
+    }
+  }
+
+  void SetPpuSync(PpuSync sync) {
+    SyncPpu();
+    ppu_sync = sync;
+    ppu_quiet = ppu.VblankDots();
+  }
+
+  uint64_t PpuDot() {
+    SyncPpu();
+    return ppu.Dot();
+  }
+  uint64_t PpuLine() {
+    SyncPpu();
+    return ppu.Line();
+  }
   void ApuTick(uint64_t n) { apu.Tick(n); }
 
+  std::shared_ptr<mappers::Mapper> Cartridge() { return cartridge; }
+  uint8_t* Ram() { return ram.data(); }
+
  private:
+  uint8_t HandleRead(uint16_t addr);
+  void HandleWrite(uint16_t addr, uint8_t value);
+  uint8_t ReadIo(uint16_t addr);
+  void WriteIo(uint16_t addr, uint8_t value);
+
+  // declared first so that the PPU and APU can be handed them
+  uint32_t pending = 0;
+  events::Scheduler scheduler;
   std::shared_ptr<mappers::Mapper> cartridge;
   graphics::Ppu ppu;
   std::array<uint8_t, 0x800> ram;
-  bool in_dma = false;
+  // filled in by the constructor and, for 0x4020-0xFFFF, the mapper
+  mappers::CpuPages pages;
+  std::array<PageHandler, 256> handlers;
   uint8_t dma_data = 0x00;
   uint16_t dma_addr = 0x0000;
   DmaState dma_state = DmaState::Read;
 
+  std::unique_ptr<Heatmap> heatmap;
+  std::unique_ptr<SharedState> shared_state;
+
+  PpuSync ppu_sync = PpuSync::Lazy;
+  // dots the PPU is behind the CPU
+  uint64_t ppu_debt = 0;
+  // dots it can fall behind before it has to catch up
+  uint64_t ppu_quiet = 0;
+
   // controller
   uint8_t& p1_input;
   bool strobe = false;
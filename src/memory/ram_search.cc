@@ -0,0 +1,197 @@
+#include "ram_search.h"
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "src/memory/work_ram.h"
+
+namespace memory {
+
+namespace {
+
+constexpr int WORD_BYTES = 64;
+
+/*
+  Bit i set if a[i] op (b[i] + delta) for 64 bytes. SSE2 has no unsigned
+  byte comparisons, so bytes are flipped into signed order first.
+*/
+template <Compare op>
+uint64_t Mask(const uint8_t* a, const uint8_t* b, uint8_t delta) {
+  uint64_t mask = 0;
+
+#if defined(__SSE2__)
+  const __m128i add = _mm_set1_epi8(static_cast<char>(delta));
+  const __m128i sign = _mm_set1_epi8(static_cast<char>(0x80));
+
+  for (int i = 0; i < WORD_BYTES; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    __m128i y = _mm_add_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)), add);
+    __m128i result;
+
+    if constexpr (op == Compare::Equal || op == Compare::NotEqual) {
+      result = _mm_cmpeq_epi8(x, y);
+    } else {
+      x = _mm_xor_si128(x, sign);
+      y = _mm_xor_si128(y, sign);
+      result = op == Compare::Greater || op == Compare::LessEqual
+                   ? _mm_cmpgt_epi8(x, y)
+                   : _mm_cmpgt_epi8(y, x);
+    }
+
+    mask |= static_cast<uint64_t>(_mm_movemask_epi8(result)) << i;
+  }
+
+  // the second of each pair is the complement of the first
+  if constexpr (op == Compare::NotEqual || op == Compare::LessEqual ||
+                op == Compare::GreaterEqual) {
+    mask = ~mask;
+  }
+#else
+  for (int i = 0; i < WORD_BYTES; i++) {
+    uint8_t x = a[i];
+    uint8_t y = b[i] + delta;
+    bool holds;
+
+    switch (op) {
+      case Compare::Equal:
+        holds = x == y;
+        break;
+      case Compare::NotEqual:
+        holds = x != y;
+        break;
+      case Compare::Less:
+        holds = x < y;
+        break;
+      case Compare::Greater:
+        holds = x > y;
+        break;
+      case Compare::LessEqual:
+        holds = x <= y;
+        break;
+      case Compare::GreaterEqual:
+        holds = x >= y;
+        break;
+    }
+
+    mask |= static_cast<uint64_t>(holds) << i;
+  }
+#endif
+
+  return mask;
+}
+
+}  // namespace
+
+void RamSearch::Reset() {
+  snapshots.clear();
+  candidates.fill(~uint64_t{0});
+}
+
+void RamSearch::Add(const WorkRam& snapshot) { snapshots.push_back(snapshot); }
+
+void RamSearch::FilterValue(Compare op, uint8_t value, uint64_t first) {
+  std::array<uint8_t, WORD_BYTES> block;
+  block.fill(value);
+  Filter(op, first, block.data(), 0);
+}
+
+void RamSearch::FilterPrevious(Compare op, uint64_t first) {
+  if (first == 0) {
+    throw "The first snapshot has no previous one to compare with";
+  }
+
+  Filter(op, first, nullptr, 0);
+}
+
+void RamSearch::FilterDelta(uint8_t delta, uint64_t first) {
+  if (first == 0) {
+    throw "The first snapshot has no previous one to compare with";
+  }
+
+  Filter(Compare::Equal, first, nullptr, delta);
+}
+
+// Word by word, so that a word is dropped as soon as it runs out of
+// candidates rather than compared in every remaining snapshot.
+template <Compare op>
+void RamSearch::Filter(uint64_t first, const uint8_t* block, uint8_t delta) {
+  for (uint64_t word = 0; word < candidates.size(); word++) {
+    uint64_t offset = word * WORD_BYTES;
+    uint64_t& bits = candidates[word];
+
+    for (uint64_t i = first; i < snapshots.size() && bits != 0; i++) {
+      const uint8_t* other =
+          block != nullptr ? block : snapshots[i - 1].data() + offset;
+      bits &= Mask<op>(snapshots[i].data() + offset, other, delta);
+    }
+  }
+}
+
+void RamSearch::Filter(Compare op, uint64_t first, const uint8_t* block,
+                       uint8_t delta) {
+  if (first >= snapshots.size()) {
+    throw "No such snapshot";
+  }
+
+  switch (op) {
+    case Compare::Equal:
+      return Filter<Compare::Equal>(first, block, delta);
+    case Compare::NotEqual:
+      return Filter<Compare::NotEqual>(first, block, delta);
+    case Compare::Less:
+      return Filter<Compare::Less>(first, block, delta);
+    case Compare::Greater:
+      return Filter<Compare::Greater>(first, block, delta);
+    case Compare::LessEqual:
+      return Filter<Compare::LessEqual>(first, block, delta);
+    case Compare::GreaterEqual:
+      return Filter<Compare::GreaterEqual>(first, block, delta);
+  }
+}
+
+uint64_t RamSearch::Count() {
+  uint64_t count = 0;
+
+  for (uint64_t bits : candidates) {
+    count += std::bitset<64>(bits).count();
+  }
+
+  return count;
+}
+
+std::vector<uint16_t> RamSearch::Candidates() {
+  std::vector<uint16_t> addresses;
+
+  for (int index = 0; index < WORK_RAM_SIZE; index++) {
+    if ((candidates[index / 64] >> (index % 64)) & 1) {
+      addresses.push_back(WorkRamAddress(index));
+    }
+  }
+
+  return addresses;
+}
+
+void RamSearch::Save(const std::string& path) {
+  std::FILE* file = std::fopen(path.c_str(), "w");
+
+  if (file == nullptr) {
+    throw "Could not open address list";
+  }
+
+  for (uint16_t addr : Candidates()) {
+    std::fprintf(file, "0x%04X\n", addr);
+  }
+
+  std::fclose(file);
+}
+
+}  // namespace memory
@@ -0,0 +1,68 @@
+#ifndef SRC_MEMORY_RAM_SEARCH_H_
+#define SRC_MEMORY_RAM_SEARCH_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/memory/work_ram.h"
+
+namespace memory {
+
+// How a snapshot's bytes compare with the other side, as unsigned values.
+enum class Compare {
+  Equal,
+  NotEqual,
+  Less,
+  Greater,
+  LessEqual,
+  GreaterEqual,
+};
+
+/*
+  Finds where a game keeps a variable by narrowing down candidate work RAM
+  addresses over a series of snapshots. Candidates are a bitset; filters
+  compare 64 addresses at a time with SIMD and skip words that have no
+  candidates left, so they stay fast over thousands of snapshots.
+*/
+class RamSearch {
+ public:
+  RamSearch() { Reset(); }
+
+  // Every address a candidate again, and no snapshots.
+  void Reset();
+  void Add(const WorkRam& snapshot);
+  uint64_t Snapshots() { return snapshots.size(); }
+
+  // Each filter keeps the candidates for which the comparison holds in
+  // every snapshot from `first` up to the latest one.
+
+  // snapshot op value
+  void FilterValue(Compare op, uint8_t value, uint64_t first);
+  // snapshot op the snapshot before it, e.g. NotEqual for changed values
+  void FilterPrevious(Compare op, uint64_t first);
+  // snapshot == the snapshot before it + delta, wrapping around
+  void FilterDelta(uint8_t delta, uint64_t first);
+
+  uint64_t Count();
+  // CPU addresses of the candidates, in order
+  std::vector<uint16_t> Candidates();
+  // Writes the candidates as a list of addresses in hex, one per line.
+  void Save(const std::string& path);
+
+ private:
+  // Compares with the 64 bytes at `block` for every 64-byte word, or with
+  // the snapshot before if `block` is nullptr, after adding delta to them.
+  template <Compare op>
+  void Filter(uint64_t first, const uint8_t* block, uint8_t delta);
+  void Filter(Compare op, uint64_t first, const uint8_t* block,
+              uint8_t delta);
+
+  std::vector<WorkRam> snapshots;
+  std::array<uint64_t, WORK_RAM_SIZE / 64> candidates;
+};
+
+}  // namespace memory
+
+#endif  // SRC_MEMORY_RAM_SEARCH_H_
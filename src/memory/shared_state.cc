@@ -0,0 +1,87 @@
+#include "shared_state.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include "src/ppu/ppu.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NESEMU_SHARED_STATE_SUPPORTED
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace memory {
+
+SharedState::SharedState(const std::string& name) : name(name) {
+#if defined(NESEMU_SHARED_STATE_SUPPORTED)
+  int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+
+  if (fd < 0) {
+    throw "Could not open shared memory object";
+  }
+
+  if (ftruncate(fd, sizeof(SharedStateLayout)) != 0) {
+    close(fd);
+    shm_unlink(name.c_str());
+    throw "Could not size shared memory object";
+  }
+
+  void* memory = mmap(nullptr, sizeof(SharedStateLayout),
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  // the mapping keeps the object open
+  close(fd);
+
+  if (memory == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    throw "Could not map shared memory object";
+  }
+
+  // zeroed, whatever an earlier run left there
+  state = new (memory) SharedStateLayout();
+  std::memcpy(state->magic, SHARED_STATE_MAGIC, sizeof(state->magic));
+  state->version = SHARED_STATE_VERSION;
+  state->size = sizeof(SharedStateLayout);
+#else
+  throw "Shared memory export needs a POSIX system";
+#endif
+}
+
+SharedState::~SharedState() {
+#if defined(NESEMU_SHARED_STATE_SUPPORTED)
+  munmap(state, sizeof(SharedStateLayout));
+  shm_unlink(name.c_str());
+#endif
+}
+
+void SharedState::Publish(const SharedRegisters& registers, uint64_t cycles,
+                          const uint8_t* screen, const uint8_t* ram,
+                          const std::array<uint8_t, 256>& oam,
+                          const std::array<uint8_t, 32>& palette_ram) {
+  uint64_t sequence = state->sequence.load(std::memory_order_relaxed);
+  state->sequence.store(sequence + 1, std::memory_order_relaxed);
+  // keeps the writes below from being seen before the odd sequence
+  std::atomic_thread_fence(std::memory_order_release);
+
+  uint64_t frame = state->frame + 1;
+  uint32_t slot = frame % SHARED_SCREENS;
+
+  state->frame = frame;
+  state->cycles = cycles;
+  state->registers = registers;
+  std::memcpy(state->screens[slot].data(), screen, graphics::SCREEN_SIZE);
+  state->screen_frames[slot] = frame;
+  state->screen = slot;
+  std::memcpy(state->ram.data(), ram, state->ram.size());
+  state->oam = oam;
+  state->palette_ram = palette_ram;
+
+  state->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+}  // namespace memory
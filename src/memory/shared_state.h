@@ -0,0 +1,92 @@
+#ifndef SRC_MEMORY_SHARED_STATE_H_
+#define SRC_MEMORY_SHARED_STATE_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "src/ppu/ppu.h"
+
+namespace memory {
+
+// first bytes of the segment; readers should also check the version
+constexpr char SHARED_STATE_MAGIC[8] = {'N', 'E', 'S', 'S', 'H', 'M', '0', '1'};
+constexpr uint32_t SHARED_STATE_VERSION = 1;
+// screens kept in the ring
+constexpr int SHARED_SCREENS = 4;
+
+struct SharedRegisters {
+  uint16_t PC;
+  uint8_t A;
+  uint8_t X;
+  uint8_t Y;
+  uint8_t SP;
+  // with B and the unused bit clear
+  uint8_t P;
+  uint8_t unused;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+/*
+  Layout of the shared memory segment, rewritten at every VBlank.
+
+  Everything after `sequence` is guarded by it as a seqlock: it is odd while
+  the emulator is writing. A reader reads it, copies what it needs, and
+  reads it again; the copy is consistent if both reads were the same even
+  number, and has to be retried otherwise. The emulator never waits for
+  readers.
+
+  Screens go round a ring, so a screen stays put for SHARED_SCREENS - 1
+  further frames. A reader can note `screen` inside the seqlock and copy
+  that screen outside it, as long as `sequence` has advanced by no more
+  than 2 * (SHARED_SCREENS - 1) once the copy is done.
+*/
+struct SharedStateLayout {
+  char magic[8];
+  uint32_t version;
+  // sizeof(SharedStateLayout)
+  uint32_t size;
+  std::atomic<uint64_t> sequence;
+
+  // VBlanks published so far, and CPU cycles at the latest
+  uint64_t frame;
+  uint64_t cycles;
+  SharedRegisters registers;
+  // slot of the latest screen
+  uint32_t screen;
+  uint32_t unused;
+  // the frame each slot holds
+  std::array<uint64_t, SHARED_SCREENS> screen_frames;
+  std::array<uint8_t, 0x800> ram;
+  std::array<uint8_t, 256> oam;
+  std::array<uint8_t, 32> palette_ram;
+  // RGBA, as graphics::Ppu::screen
+  std::array<std::array<uint8_t, graphics::SCREEN_SIZE>, SHARED_SCREENS>
+      screens;
+};
+
+/*
+  A POSIX shared memory object holding a SharedStateLayout, for other
+  processes on the host to watch the machine. The object is unlinked again
+  when this is destroyed.
+*/
+class SharedState {
+ public:
+  SharedState(const std::string& name);
+  ~SharedState();
+
+  void Publish(const SharedRegisters& registers, uint64_t cycles,
+               const uint8_t* screen, const uint8_t* ram,
+               const std::array<uint8_t, 256>& oam,
+               const std::array<uint8_t, 32>& palette_ram);
+
+ private:
+  std::string name;
+  SharedStateLayout* state;
+};
+
+}  // namespace memory
+
+#endif  // SRC_MEMORY_SHARED_STATE_H_
@@ -0,0 +1,39 @@
+#ifndef SRC_MEMORY_WORK_RAM_H_
+#define SRC_MEMORY_WORK_RAM_H_
+
+#include <array>
+#include <cstdint>
+
+namespace memory {
+
+/*
+  The memory a game keeps its state in, indexed as one block: internal RAM
+  (0x0000-0x07FF, mirrors folded in) followed by PRG-RAM (0x6000-0x7FFF).
+  Used by the heatmap and RAM search.
+*/
+constexpr int WORK_RAM_INTERNAL = 0x800;
+constexpr int WORK_RAM_PRG = 0x2000;
+constexpr int WORK_RAM_SIZE = WORK_RAM_INTERNAL + WORK_RAM_PRG;
+
+using WorkRam = std::array<uint8_t, WORK_RAM_SIZE>;
+
+// index of addr, or -1 if it isn't work RAM
+constexpr int WorkRamIndex(uint16_t addr) {
+  if (addr < 0x2000) {
+    return addr & 0x7FF;
+  }
+  if (addr >= 0x6000 && addr < 0x8000) {
+    return WORK_RAM_INTERNAL + (addr - 0x6000);
+  }
+  return -1;
+}
+
+// CPU address of an index
+constexpr uint16_t WorkRamAddress(int index) {
+  return index < WORK_RAM_INTERNAL ? index
+                                   : 0x6000 + (index - WORK_RAM_INTERNAL);
+}
+
+}  // namespace memory
+
+#endif  // SRC_MEMORY_WORK_RAM_H_
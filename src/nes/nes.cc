@@ -204,6 +204,8 @@ void Nes::Test(uint64_t num_frames, std::string filepath) {
       case cpu::Event::AudioBufferFull:
         cpu.GetAudioBuffer();
         break;
+      case cpu::Event::Breakpoint:
+        break;
       case cpu::Event::Stopped:
         throw "Emulator Stopped";
     }
@@ -240,6 +242,8 @@ void Nes::TestAudio(uint64_t num_frames, std::string filepath) {
         }
         break;
       }
+      case cpu::Event::Breakpoint:
+        break;
       case cpu::Event::Stopped:
         std::cout << "Emulator Stopped exception in TestAudio" << std::endl;
         throw "Emulator Stopped";
@@ -259,6 +263,8 @@ void Nes::Emulate() {
       case cpu::Event::AudioBufferFull:
         QueueAudio();
         break;
+      case cpu::Event::Breakpoint:
+        break;
       case cpu::Event::Stopped:
         std::cout << "Emulator Stopped" << std::endl;
         throw "Emulator Stopped";
@@ -1,5 +1,6 @@
 #include "ppu.h"
 
+#include <algorithm>
 #include <array>
 #include <bitset>
 #include <cstdint>
@@ -10,6 +11,7 @@
 #include <memory>
 #include <vector>
 
+#include "src/mappers/dispatch.h"
 #include "src/mappers/mapper.h"
 #include "src/mirroring/mirroring.h"
 #include "src/ppu/palette.h"
@@ -17,7 +19,7 @@
 
 namespace graphics {
 
-Ppu::Ppu(std::shared_ptr<mappers::Mapper> mapper)
+Ppu::Ppu(std::shared_ptr<mappers::Mapper> mapper, uint32_t& pending)
     : screen(SCREEN_SIZE, 0),
       pat_table1(PAT_TABLE_SIZE, 0),
       pat_table2(PAT_TABLE_SIZE, 0),
@@ -28,6 +30,7 @@ Ppu::Ppu(std::shared_ptr<mappers::Mapper> mapper)
       sprites(SPRITES_SIZE, 0),
       palettes(PALETTES_SIZE, 0),
       cartridge(std::move(mapper)),
+      pending(pending),
       pattern_queue1(),
       pattern_queue2(),
       palette_queue1(),
@@ -477,7 +480,7 @@ void Ppu::PostRenderTick() {}
 void Ppu::VBlankTick() {
   if (line == 241 and dot == 1) {
     in_vblank = true;
-    vblank_event = true;
+    pending |= events::VBLANK;
     UpdateNmi();
   }
 }
@@ -527,12 +530,81 @@ void Ppu::NextDot() {
 
 bool Ppu::Disabled() { return !show_bg && !show_sprites; }
 
-bool Ppu::NmiOccured() { return nmi_pending; }
+bool Ppu::NmiOccured() { return static_cast<bool>(pending & events::NMI); }
 
-void Ppu::ClearNmi() { nmi_pending = false; }
+void Ppu::ClearNmi() { pending &= ~events::NMI; }
 
 void Ppu::OamDmaWrite(uint8_t value) { obj_attr_memory[oam_addr++] = value; }
 
+void Ppu::OamDmaCopy(const uint8_t* page) {
+  for (int i = 0; i < 256; i++) {
+    obj_attr_memory[oam_addr++] = page[i];
+  }
+}
+
+uint64_t Ppu::VblankDots() {
+  uint64_t now = line * LINE_DOTS + dot;
+
+  // visible lines start on dot 1 in even frames, see NextDot
+  if (now <= VBLANK_DOT) {
+    uint64_t skipped = frame % 2 == 0 && line < 239 ? 239 - line : 0;
+    return VBLANK_DOT - now - skipped;
+  }
+
+  uint64_t skipped = (frame + 1) % 2 == 0 ? 240 : 0;
+  return FRAME_DOTS - now + VBLANK_DOT - skipped;
+}
+
+uint64_t Ppu::QuietDots() {
+  // sprites are evaluated on dot 256 of every visible line
+  constexpr uint64_t LAST_EVAL_DOT = 239 * LINE_DOTS + 256;
+
+  if (Disabled()) {
+    return VblankDots();
+  }
+
+  uint64_t now = line * LINE_DOTS + dot;
+  uint64_t eval;
+
+  if (now > LAST_EVAL_DOT) {
+    eval = FRAME_DOTS - now + 256 - ((frame + 1) % 2 == 0 ? 1 : 0);
+  } else if (dot <= 256) {
+    eval = 256 - dot;
+  } else {
+    eval = LINE_DOTS - dot + 256 - (frame % 2 == 0 ? 1 : 0);
+  }
+
+  return std::min(VblankDots(), eval);
+}
+
+uint64_t Ppu::StatusDots() {
+  // the pre-render line clears the flags on its dot 1
+  constexpr uint64_t CLEAR_DOT = 261 * LINE_DOTS + 1;
+  uint64_t now = line * LINE_DOTS + dot;
+  uint8_t flags = (static_cast<uint8_t>(in_vblank) << 7) |
+                  (static_cast<uint8_t>(sprite0_hit) << 6) |
+                  (static_cast<uint8_t>(sprite_overflow) << 5);
+
+  // changed since the last read
+  if (flags != read_flags) {
+    return 0;
+  }
+
+  // VBlank is raised as VBLANK_DOT is run
+  if (now > VBLANK_DOT && now < CLEAR_DOT) {
+    return CLEAR_DOT - now - 1;
+  }
+
+  // sprite 0 hit and overflow can be set anywhere on a visible line
+  bool rendering = now < 240 * LINE_DOTS || now >= CLEAR_DOT;
+
+  if (rendering && !Disabled() && !(sprite0_hit && sprite_overflow)) {
+    return 0;
+  }
+
+  return VblankDots();
+}
+
 uint8_t Ppu::Read(uint16_t addr) {
   switch (addr) {
     case 0x2002:
@@ -605,6 +677,7 @@ uint8_t Ppu::ReadPpuStatus() {
                   (static_cast<uint8_t>(sprite_overflow) << 5) |
                   (last_write & 0x1F);
 
+  read_flags = value & 0xE0;
   in_vblank = false;
   UpdateNmi();
   reg_W = Toggle::Write1;
@@ -646,7 +719,7 @@ uint8_t Ppu::ReadPpuData() {
     value = read_buffer;
     read_buffer = ReadVram(reg_V);
   } else {
-    read_buffer = cartridge->PpuRead(reg_V);
+    read_buffer = mappers::PpuRead(*cartridge, reg_V);
     value = ReadVram(reg_V);
   }
 
@@ -673,12 +746,14 @@ uint16_t Ppu::CalcNametableAddr(uint8_t x) {
 }
 
 void Ppu::UpdateNmi() {
-  nmi_pending = nmi_pending || (in_vblank && generate_vblank_nmi);
+  if (in_vblank && generate_vblank_nmi) {
+    pending |= events::NMI;
+  }
 }
 
 uint8_t Ppu::ReadVram(uint16_t addr) {
   if (addr <= 0x3EFF) {
-    return cartridge->PpuRead(addr);
+    return mappers::PpuRead(*cartridge, addr);
   } else if (addr <= 0x3F1F) {
     switch (addr) {
       case 0x3F10:
@@ -696,9 +771,9 @@ uint8_t Ppu::ReadVram(uint16_t addr) {
 
 void Ppu::WriteVram(uint16_t addr, uint8_t value) {
   if (addr <= 0x1FFF) {
-    cartridge->PpuWrite(addr, value);
+    mappers::PpuWrite(*cartridge, addr, value);
   } else if (addr <= 0x3EFF) {
-    cartridge->PpuWrite(addr, value);
+    mappers::PpuWrite(*cartridge, addr, value);
   } else if (addr <= 0x3F1F) {
     switch (addr) {
       case 0x3F10:
@@ -9,6 +9,7 @@
 #include <queue>
 #include <vector>
 
+#include "src/events/events.h"
 #include "src/mappers/mapper.h"
 #include "src/mirroring/mirroring.h"
 #include "src/ppu/palette.h"
@@ -44,6 +45,11 @@ constexpr int PALETTES_HEIGHT =
 constexpr int PALETTES_SIZE =
     PALETTES_WIDTH * PALETTES_HEIGHT * SCREEN_CHANNELS;
 
+constexpr uint64_t LINE_DOTS = 341;
+constexpr uint64_t FRAME_DOTS = 262 * LINE_DOTS;
+// VBlankTick raises VBlank on this dot of the frame
+constexpr uint64_t VBLANK_DOT = 241 * LINE_DOTS + 1;
+
 constexpr uint16_t PALETTE_ADDRS[4][3] = {
     {0x3F01, 0x3F02, 0x3F03},
     {0x3F05, 0x3F06, 0x3F07},
@@ -59,12 +65,24 @@ struct Color {
 
 class Ppu {
  public:
-  Ppu(std::shared_ptr<mappers::Mapper> mapper);
+  Ppu(std::shared_ptr<mappers::Mapper> mapper, uint32_t& pending);
 
   void Tick(uint64_t cycles);
+  uint64_t Dot() { return dot; }
+  uint64_t Line() { return line; }
   bool NmiOccured();
   void ClearNmi();
   void OamDmaWrite(uint8_t value);
+  // OAM DMA of a whole page at once
+  void OamDmaCopy(const uint8_t* page);
+  // Lower bounds on the dots the PPU can run from here without raising
+  // VBlank, without raising VBlank or reading OAM, and without raising
+  // VBlank or a PPUSTATUS read returning anything the last one didn't.
+  uint64_t VblankDots();
+  uint64_t QuietDots();
+  uint64_t StatusDots();
+  const std::array<uint8_t, 256>& Oam() { return obj_attr_memory; }
+  const std::array<uint8_t, 32>& PaletteRam() { return palette_ram_idxs; }
 
   uint8_t Read(uint16_t addr);
   void Write(uint16_t addr, uint8_t value);
@@ -87,10 +105,10 @@ class Ppu {
   std::vector<uint8_t> sprites;
   std::vector<uint8_t> palettes;
 
-  bool vblank_event = false;
-
  private:
   std::shared_ptr<mappers::Mapper> cartridge;
+  // NMI and VBLANK bits, see src/events/events.h
+  uint32_t& pending;
 
   /*****************************************************
     PPU state machine methods
@@ -219,6 +237,8 @@ class Ppu {
   bool sprite_overflow = false;
   bool sprite0_hit = false;
   bool in_vblank = false;
+  // the flags as the last read returned them
+  uint8_t read_flags = 0x00;
 
   /* OAMADDR 0x2003 */
   uint8_t oam_addr = 0x0;
@@ -262,8 +282,6 @@ class Ppu {
   uint16_t bg_addr = 0x0;
   uint8_t bg_tile_low = 0x0;
   uint8_t bg_tile_high = 0x0;
-  // NMI
-  bool nmi_pending = false;
 
   /*---------------------------------------------------
     Selected Palette
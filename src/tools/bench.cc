@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "src/cpu/cpu.h"
+#include "src/cpu/event.h"
+#include "src/cpu/jit.h"
+#include "src/cpu/opcodes.h"
+#include "src/cpu/profile.h"
+#include "src/features/features.h"
+#include "src/memory/memory.h"
+
+constexpr uint64_t MAX_CYCLES = 29780;
+constexpr uint64_t DEFAULT_FRAMES = 3600;
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0]
+              << " <rom> [frames] [off|jit|check] [trace|-] [lazy|eager]"
+              << std::endl;
+    return 1;
+  }
+
+  uint64_t num_frames = argc > 2 ? std::stoull(argv[2]) : DEFAULT_FRAMES;
+
+  if (num_frames == 0) {
+    std::cerr << "frames must be at least 1" << std::endl;
+    return 1;
+  }
+
+  std::string jit = argc > 3 ? argv[3] : "off";
+
+  cpu::Cpu cpu(argv[1]);
+  cpu.Startup();
+
+  if (jit == "jit") {
+    cpu.SetJitMode(cpu::JitMode::On);
+  } else if (jit == "check") {
+    cpu.SetJitMode(cpu::JitMode::Check);
+  } else if (jit != "off") {
+    std::cerr << "unknown JIT mode: " << jit << std::endl;
+    return 1;
+  }
+
+  std::string ppu = argc > 5 ? argv[5] : "lazy";
+
+  if (ppu == "eager") {
+    cpu.SetPpuSync(memory::PpuSync::Eager);
+  } else if (ppu != "lazy") {
+    std::cerr << "unknown PPU sync: " << ppu << std::endl;
+    return 1;
+  }
+
+  if (argc > 4 && std::string(argv[4]) != "-") {
+    cpu.StartTrace(argv[4]);
+  }
+
+  uint64_t frames = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  while (frames < num_frames) {
+    switch (cpu.RunTillEvent(MAX_CYCLES)) {
+      case cpu::Event::VBlank:
+        frames++;
+        break;
+      case cpu::Event::MaxCycles:
+        break;
+      case cpu::Event::AudioBufferFull:
+        cpu.GetAudioBuffer();
+        break;
+      case cpu::Event::Breakpoint:
+        break;
+      case cpu::Event::Stopped:
+        std::cerr << "Emulator Stopped" << std::endl;
+        return 1;
+    }
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  cpu.StopTrace();
+  double seconds = elapsed.count();
+
+  std::cout << "backend: " << cpu::DISPATCH_BACKEND << std::endl;
+  std::cout << "features: " << features::NAME << std::endl;
+  std::cout << "jit: " << jit << std::endl;
+  std::cout << "ppu: " << ppu << std::endl;
+  std::cout << "frames: " << frames << std::endl;
+  std::cout << "instructions: " << cpu.Instructions() << std::endl;
+  std::cout << "decode cache hits: " << cpu.DecodeCacheHits() << std::endl;
+  std::cout << "decode cache misses: " << cpu.DecodeCacheMisses()
+            << std::endl;
+  std::cout << "jit blocks: " << cpu.JitBlocks() << std::endl;
+  std::cout << "jit instructions: " << cpu.JitInstructions() << std::endl;
+  std::cout << "idle cycles skipped/frame: " << cpu.IdleCycles() / frames
+            << std::endl;
+  std::cout << "seconds: " << seconds << std::endl;
+  std::cout << "instructions/s: " << cpu.Instructions() / seconds
+            << std::endl;
+  std::cout << "frames/s: " << frames / seconds << std::endl;
+
+  if (cpu::PROFILE_ENABLED) {
+    std::string path = std::string(argv[1]) + ".profile.json";
+    std::ofstream out(path);
+    cpu.GetProfile().WriteJson(out);
+    std::cout << "profile: " << path << std::endl;
+  }
+}
@@ -0,0 +1,60 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "src/cpu/coverage.h"
+#include "src/cpu/cpu.h"
+#include "src/cpu/event.h"
+
+/*
+  Runs a ROM headless while recording which PRG-ROM bytes it executes or
+  reads, merges that into a CDL file (created if missing) and reports how
+  much of PRG-ROM the file now covers.
+*/
+
+constexpr uint64_t MAX_CYCLES = 29780;
+constexpr uint64_t DEFAULT_FRAMES = 3600;
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0] << " <rom> <cdl> [frames]" << std::endl;
+    return 1;
+  }
+
+  uint64_t num_frames = argc > 3 ? std::stoull(argv[3]) : DEFAULT_FRAMES;
+
+  cpu::Cpu cpu(argv[1]);
+  cpu.Startup();
+  cpu.StartCoverage();
+  cpu::Coverage& coverage = *cpu.GetCoverage();
+  coverage.Merge(argv[2]);
+
+  uint64_t before = coverage.Covered();
+  uint64_t frames = 0;
+
+  while (frames < num_frames) {
+    switch (cpu.RunTillEvent(MAX_CYCLES)) {
+      case cpu::Event::VBlank:
+        frames++;
+        break;
+      case cpu::Event::MaxCycles:
+        break;
+      case cpu::Event::AudioBufferFull:
+        cpu.GetAudioBuffer();
+        break;
+      case cpu::Event::Breakpoint:
+        break;
+      case cpu::Event::Stopped:
+        std::cerr << "Emulator Stopped" << std::endl;
+        return 1;
+    }
+  }
+
+  coverage.Save(argv[2]);
+
+  uint64_t covered = coverage.Covered();
+  std::cout << "PRG-ROM bytes: " << coverage.Size() << std::endl;
+  std::cout << "covered: " << covered << " ("
+            << 100.0 * covered / coverage.Size() << "%)" << std::endl;
+  std::cout << "new this run: " << covered - before << std::endl;
+}
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "src/cpu/cpu.h"
+#include "src/cpu/event.h"
+#include "src/memory/heatmap.h"
+#include "src/memory/work_ram.h"
+
+/*
+  Runs a ROM headless while counting accesses to RAM and PRG-RAM, then reads
+  the per-frame heatmap stream back: prints how busy every frame was and
+  the busiest addresses overall, and renders the totals as a PPM image.
+
+  The image has one cell per address, 64 to a row: internal RAM on top,
+  PRG-RAM below it after a blank row. Reads are green and writes red, on a
+  log scale, so an address that is both read and written a lot is yellow.
+*/
+
+constexpr uint64_t MAX_CYCLES = 29780;
+constexpr uint64_t DEFAULT_FRAMES = 600;
+constexpr int ROW_CELLS = 64;
+constexpr int CELL_PIXELS = 4;
+// addresses listed at the end
+constexpr int TOP_ADDRESSES = 16;
+
+struct Totals {
+  std::array<uint64_t, memory::WORK_RAM_SIZE> reads = {};
+  std::array<uint64_t, memory::WORK_RAM_SIZE> writes = {};
+};
+
+// Reads a heatmap stream, printing a line per frame and summing the counts.
+Totals ReadStream(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  char magic[sizeof(memory::HEATMAP_MAGIC)];
+
+  if (!in.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), memory::HEATMAP_MAGIC)) {
+    throw "Not a heatmap file";
+  }
+
+  Totals totals;
+  memory::HeatmapFrame frame;
+  std::vector<memory::HeatmapEntry> entries;
+
+  std::printf("frame   reads  writes  addresses\n");
+
+  while (in.read(reinterpret_cast<char*>(&frame), sizeof(frame))) {
+    entries.resize(frame.entries);
+    in.read(reinterpret_cast<char*>(entries.data()),
+            entries.size() * sizeof(memory::HeatmapEntry));
+
+    if (!in) {
+      throw "Heatmap file ends in the middle of a frame";
+    }
+
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+
+    for (const memory::HeatmapEntry& entry : entries) {
+      if (entry.index >= memory::WORK_RAM_SIZE) {
+        throw "Heatmap entry out of range";
+      }
+
+      totals.reads[entry.index] += entry.reads;
+      totals.writes[entry.index] += entry.writes;
+      reads += entry.reads;
+      writes += entry.writes;
+    }
+
+    std::printf("%5u %7llu %7llu %10u\n", frame.frame,
+                static_cast<unsigned long long>(reads),
+                static_cast<unsigned long long>(writes), frame.entries);
+  }
+
+  return totals;
+}
+
+// 0-255 for count on a log scale where max is 255.
+uint8_t Intensity(uint64_t count, uint64_t max) {
+  if (count == 0) {
+    return 0;
+  }
+
+  return static_cast<uint8_t>(
+      std::lround(255.0 * std::log1p(count) / std::log1p(max)));
+}
+
+void WriteImage(const Totals& totals, const std::string& path) {
+  constexpr int RAM_ROWS = memory::WORK_RAM_INTERNAL / ROW_CELLS;
+  constexpr int ROWS = memory::WORK_RAM_SIZE / ROW_CELLS + 1;
+  constexpr int WIDTH = ROW_CELLS * CELL_PIXELS;
+  constexpr int HEIGHT = ROWS * CELL_PIXELS;
+
+  uint64_t max_reads =
+      *std::max_element(totals.reads.begin(), totals.reads.end());
+  uint64_t max_writes =
+      *std::max_element(totals.writes.begin(), totals.writes.end());
+  std::vector<uint8_t> pixels(WIDTH * HEIGHT * 3);
+
+  for (int index = 0; index < memory::WORK_RAM_SIZE; index++) {
+    int row = index / ROW_CELLS;
+    // leave a blank row between RAM and PRG-RAM
+    if (row >= RAM_ROWS) {
+      row++;
+    }
+    int col = index % ROW_CELLS;
+    uint8_t red = Intensity(totals.writes[index], max_writes);
+    uint8_t green = Intensity(totals.reads[index], max_reads);
+
+    for (int y = 0; y < CELL_PIXELS; y++) {
+      for (int x = 0; x < CELL_PIXELS; x++) {
+        uint64_t pixel = ((row * CELL_PIXELS + y) * WIDTH +
+                          col * CELL_PIXELS + x) * 3;
+        pixels[pixel] = red;
+        pixels[pixel + 1] = green;
+      }
+    }
+  }
+
+  std::ofstream out(path, std::ios::binary);
+  out << "P6\n" << WIDTH << " " << HEIGHT << "\n255\n";
+
+  if (!out.write(reinterpret_cast<const char*>(pixels.data()),
+                 pixels.size())) {
+    throw "Could not write heatmap image";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 4) {
+    std::cerr << "usage: " << argv[0] << " <rom> <stream> <image.ppm> [frames]"
+              << std::endl;
+    return 1;
+  }
+
+  uint64_t num_frames = argc > 4 ? std::stoull(argv[4]) : DEFAULT_FRAMES;
+
+  cpu::Cpu cpu(argv[1]);
+  cpu.Startup();
+  cpu.StartHeatmap(argv[2]);
+
+  uint64_t frames = 0;
+
+  while (frames < num_frames) {
+    switch (cpu.RunTillEvent(MAX_CYCLES)) {
+      case cpu::Event::VBlank:
+        frames++;
+        break;
+      case cpu::Event::MaxCycles:
+        break;
+      case cpu::Event::AudioBufferFull:
+        cpu.GetAudioBuffer();
+        break;
+      case cpu::Event::Breakpoint:
+        break;
+      case cpu::Event::Stopped:
+        std::cerr << "Emulator Stopped" << std::endl;
+        return 1;
+    }
+  }
+
+  // closes the stream
+  cpu.StopHeatmap();
+
+  Totals totals = ReadStream(argv[2]);
+  WriteImage(totals, argv[3]);
+
+  std::vector<int> busiest(memory::WORK_RAM_SIZE);
+  for (int i = 0; i < memory::WORK_RAM_SIZE; i++) {
+    busiest[i] = i;
+  }
+  std::stable_sort(busiest.begin(), busiest.end(), [&](int a, int b) {
+    return totals.reads[a] + totals.writes[a] >
+           totals.reads[b] + totals.writes[b];
+  });
+
+  std::printf("\nbusiest addresses:\n");
+
+  for (int i = 0; i < TOP_ADDRESSES; i++) {
+    int index = busiest[i];
+    if (totals.reads[index] + totals.writes[index] == 0) {
+      break;
+    }
+    std::printf("$%04X %10llu reads %10llu writes\n",
+                memory::WorkRamAddress(index),
+                static_cast<unsigned long long>(totals.reads[index]),
+                static_cast<unsigned long long>(totals.writes[index]));
+  }
+}
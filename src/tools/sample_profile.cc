@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/cpu/cpu.h"
+#include "src/cpu/event.h"
+#include "src/cpu/sampler.h"
+#include "src/tools/symbols.h"
+
+/*
+  Runs a ROM headless while sampling the guest PC, then prints where the
+  guest spent its time: a flat profile over the whole run followed by the
+  busiest locations of every frame.
+*/
+
+constexpr uint64_t MAX_CYCLES = 29780;
+constexpr uint64_t DEFAULT_FRAMES = 600;
+constexpr uint64_t DEFAULT_INTERVAL = 100;
+// locations listed for each frame
+constexpr int FRAME_TOP = 3;
+
+// The label a sample key falls under, or its bank and address.
+std::string Location(cpu::Sampler& sampler, const tools::Symbols& symbols,
+                     uint32_t key) {
+  std::string label = symbols.Find(key);
+
+  if (!label.empty()) {
+    return label;
+  }
+
+  char text[16];
+
+  if (key < cpu::SAMPLE_ROM) {
+    std::snprintf(text, sizeof(text), "$%04X", key);
+  } else {
+    std::snprintf(
+        text, sizeof(text), "%02X:%04X",
+        static_cast<int>((key - cpu::SAMPLE_ROM) / cpu::SAMPLE_PRG_BANK_SIZE),
+        sampler.Address(key));
+  }
+
+  return text;
+}
+
+// Locations sorted by samples, most first.
+std::vector<std::pair<std::string, uint64_t>> Rank(
+    const std::map<std::string, uint64_t>& counts) {
+  std::vector<std::pair<std::string, uint64_t>> ranked(counts.begin(),
+                                                       counts.end());
+  std::stable_sort(ranked.begin(), ranked.end(),
+                   [](const auto& a, const auto& b) {
+                     return a.second > b.second;
+                   });
+  return ranked;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0]
+              << " <rom> [frames] [interval] [symbols...]" << std::endl;
+    return 1;
+  }
+
+  uint64_t num_frames = argc > 2 ? std::stoull(argv[2]) : DEFAULT_FRAMES;
+  uint64_t interval = argc > 3 ? std::stoull(argv[3]) : DEFAULT_INTERVAL;
+
+  cpu::Cpu cpu(argv[1]);
+  cpu.Startup();
+  cpu.StartSampling(interval);
+  cpu::Sampler& sampler = *cpu.GetSampler();
+
+  tools::Symbols symbols(
+      [&sampler](uint16_t addr) { return sampler.Key(addr); });
+  for (int i = 4; i < argc; i++) {
+    symbols.Load(argv[i]);
+  }
+
+  // Resolves every key once, as it is first seen.
+  std::map<uint32_t, std::string> locations;
+  auto locate = [&](uint32_t key) -> const std::string& {
+    auto it = locations.find(key);
+
+    if (it == locations.end()) {
+      it = locations.emplace(key, Location(sampler, symbols, key)).first;
+    }
+
+    return it->second;
+  };
+
+  // Printed after the flat profile, which needs the whole run.
+  std::vector<std::string> frame_lines;
+  uint64_t frames = 0;
+
+  while (frames < num_frames) {
+    switch (cpu.RunTillEvent(MAX_CYCLES)) {
+      case cpu::Event::VBlank: {
+        std::map<std::string, uint64_t> counts;
+        uint64_t samples = 0;
+
+        for (const cpu::SampleCount& count : sampler.LastFrame()) {
+          counts[locate(count.key)] += count.samples;
+          samples += count.samples;
+        }
+
+        char text[64];
+        std::snprintf(text, sizeof(text), "%6llu %6llu ",
+                      static_cast<unsigned long long>(frames),
+                      static_cast<unsigned long long>(samples));
+        std::string line = text;
+
+        auto ranked = Rank(counts);
+        for (int i = 0; i < FRAME_TOP && i < static_cast<int>(ranked.size());
+             i++) {
+          std::snprintf(text, sizeof(text), " %.1f%%",
+                        100.0 * ranked[i].second / samples);
+          line += " " + ranked[i].first + text;
+        }
+
+        frame_lines.push_back(line);
+        frames++;
+        break;
+      }
+      case cpu::Event::MaxCycles:
+        break;
+      case cpu::Event::AudioBufferFull:
+        cpu.GetAudioBuffer();
+        break;
+      case cpu::Event::Breakpoint:
+        break;
+      case cpu::Event::Stopped:
+        std::cerr << "Emulator Stopped" << std::endl;
+        return 1;
+    }
+  }
+
+  std::map<std::string, uint64_t> flat;
+
+  for (uint32_t key = 0; key < sampler.histogram.size(); key++) {
+    if (sampler.histogram[key] > 0) {
+      flat[locate(key)] += sampler.histogram[key];
+    }
+  }
+
+  uint64_t total = sampler.samples;
+
+  std::printf("interval: %llu cycles\n",
+              static_cast<unsigned long long>(interval));
+  std::printf("samples: %llu\n", static_cast<unsigned long long>(total));
+  std::printf("\nflat profile:\n");
+
+  for (const auto& [location, count] : Rank(flat)) {
+    std::printf("%6.2f%% %10llu  %s\n", 100.0 * count / total,
+                static_cast<unsigned long long>(count), location.c_str());
+  }
+
+  std::printf("\nper frame:\n");
+
+  for (const std::string& line : frame_lines) {
+    std::printf("%s\n", line.c_str());
+  }
+}
@@ -0,0 +1,112 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "src/memory/shared_state.h"
+
+/*
+  Attaches to the shared memory object of an emulator that called
+  Cpu::StartSharedState and prints its registers and the start of zero page
+  a few times a second. Also serves as an example of reading the
+  segment without ever blocking the emulator.
+*/
+
+constexpr auto POLL_INTERVAL = std::chrono::milliseconds(250);
+constexpr uint64_t DEFAULT_POLLS = 40;
+
+struct Sample {
+  uint64_t frame;
+  uint64_t cycles;
+  memory::SharedRegisters registers;
+  uint8_t zero_page[16];
+};
+
+// Copies what it needs under the seqlock, retrying while the emulator
+// writes.
+Sample Read(const memory::SharedStateLayout& state) {
+  while (true) {
+    uint64_t before = state.sequence.load(std::memory_order_acquire);
+
+    if (before % 2 != 0) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    Sample sample;
+    sample.frame = state.frame;
+    sample.cycles = state.cycles;
+    sample.registers = state.registers;
+    std::memcpy(sample.zero_page, state.ram.data(), sizeof(sample.zero_page));
+
+    // keeps the copies above from being done after the second read
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (state.sequence.load(std::memory_order_relaxed) == before) {
+      return sample;
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " <name> [polls]" << std::endl;
+    return 1;
+  }
+
+  uint64_t polls = argc > 2 ? std::stoull(argv[2]) : DEFAULT_POLLS;
+
+  int fd = shm_open(argv[1], O_RDONLY, 0);
+
+  if (fd < 0) {
+    std::cerr << "No shared memory object " << argv[1] << std::endl;
+    return 1;
+  }
+
+  void* memory = mmap(nullptr, sizeof(memory::SharedStateLayout), PROT_READ,
+                      MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (memory == MAP_FAILED) {
+    std::cerr << "Could not map " << argv[1] << std::endl;
+    return 1;
+  }
+
+  const auto& state = *static_cast<const memory::SharedStateLayout*>(memory);
+
+  if (std::memcmp(state.magic, memory::SHARED_STATE_MAGIC,
+                  sizeof(state.magic)) != 0 ||
+      state.version != memory::SHARED_STATE_VERSION ||
+      state.size != sizeof(memory::SharedStateLayout)) {
+    std::cerr << "Unknown layout" << std::endl;
+    return 1;
+  }
+
+  for (uint64_t i = 0; i < polls; i++) {
+    Sample sample = Read(state);
+    const memory::SharedRegisters& r = sample.registers;
+
+    std::printf("frame %6llu cycles %10llu PC %04X A %02X X %02X Y %02X "
+                "SP %02X P %02X  $00:",
+                static_cast<unsigned long long>(sample.frame),
+                static_cast<unsigned long long>(sample.cycles), r.PC, r.A,
+                r.X, r.Y, r.SP, r.P);
+
+    for (uint8_t value : sample.zero_page) {
+      std::printf(" %02X", value);
+    }
+
+    std::printf("\n");
+    std::this_thread::sleep_for(POLL_INTERVAL);
+  }
+
+  munmap(memory, sizeof(memory::SharedStateLayout));
+}
@@ -0,0 +1,169 @@
+#include "symbols.h"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "src/cpu/sampler.h"
+
+namespace tools {
+
+namespace {
+
+// iNES header in front of PRG-ROM in ld65's output file
+constexpr uint64_t INES_HEADER_SIZE = 16;
+
+// The key=value pairs of a .dbg line such as
+// sym  id=3,name="reset",addrsize=absolute,scope=0,def=9,val=0x8000,seg=0
+std::map<std::string, std::string> Fields(const std::string& line) {
+  std::map<std::string, std::string> fields;
+  size_t pos = line.find_first_of(" \t");
+
+  while (pos != std::string::npos && pos < line.size()) {
+    pos = line.find_first_not_of(" \t,", pos);
+    if (pos == std::string::npos) {
+      break;
+    }
+
+    size_t equals = line.find('=', pos);
+    if (equals == std::string::npos) {
+      break;
+    }
+
+    size_t end = equals + 1;
+    if (end < line.size() && line[end] == '"') {
+      end = line.find('"', end + 1);
+      end = end == std::string::npos ? line.size() : end + 1;
+    } else {
+      end = line.find(',', end);
+      end = end == std::string::npos ? line.size() : end;
+    }
+
+    std::string value = line.substr(equals + 1, end - equals - 1);
+    if (value.size() >= 2 && value.front() == '"') {
+      value = value.substr(1, value.size() - 2);
+    }
+
+    fields[line.substr(pos, equals - pos)] = value;
+    pos = end;
+  }
+
+  return fields;
+}
+
+uint64_t Number(const std::string& text) {
+  return std::stoull(text, nullptr, 0);
+}
+
+// -1 for CPU addresses, otherwise the 16K PRG-ROM bank
+int64_t Bank(uint32_t key) {
+  if (key < cpu::SAMPLE_ROM) {
+    return -1;
+  }
+
+  return (key - cpu::SAMPLE_ROM) / cpu::SAMPLE_PRG_BANK_SIZE;
+}
+
+}  // namespace
+
+Symbols::Symbols(std::function<uint32_t(uint16_t)> key)
+    : key(std::move(key)) {}
+
+void Symbols::Load(const std::string& path) {
+  std::ifstream in(path);
+
+  if (!in) {
+    throw "Could not open symbol file";
+  }
+
+  if (path.size() >= 4 && path.substr(path.size() - 4) == ".dbg") {
+    LoadDbg(in);
+  } else {
+    LoadList(in);
+  }
+}
+
+std::string Symbols::Find(uint32_t key) const {
+  auto it = labels.upper_bound(key);
+
+  if (it == labels.begin()) {
+    return "";
+  }
+
+  --it;
+  return Bank(it->first) == Bank(key) ? it->second : "";
+}
+
+void Symbols::LoadDbg(std::istream& in) {
+  // start address and PRG-ROM offset of every segment that ended up in ROM
+  std::map<std::string, std::pair<uint64_t, uint64_t>> segments;
+  std::string line;
+
+  while (std::getline(in, line)) {
+    if (line.rfind("seg\t", 0) == 0) {
+      auto fields = Fields(line);
+
+      if (fields.count("ooffs") && fields.count("start")) {
+        segments[fields["id"]] = {Number(fields["start"]),
+                                  Number(fields["ooffs"]) - INES_HEADER_SIZE};
+      }
+    } else if (line.rfind("sym\t", 0) == 0) {
+      auto fields = Fields(line);
+
+      if (fields["type"] != "lab" || !fields.count("val")) {
+        continue;
+      }
+
+      uint64_t addr = Number(fields["val"]);
+      auto segment = segments.find(fields["seg"]);
+
+      if (addr >= 0x8000 && addr <= 0xFFFF && segment != segments.end()) {
+        auto [start, offset] = segment->second;
+        labels[cpu::SAMPLE_ROM + offset + (addr - start)] = fields["name"];
+      } else if (addr <= 0xFFFF) {
+        labels[key(static_cast<uint16_t>(addr))] = fields["name"];
+      }
+    }
+  }
+}
+
+void Symbols::LoadList(std::istream& in) {
+  std::string line;
+
+  while (std::getline(in, line)) {
+    std::istringstream words(line);
+    std::string addr;
+    std::string name;
+
+    if (!(words >> addr >> name) || addr[0] == '#' || addr[0] == ';') {
+      continue;
+    }
+
+    int64_t bank = -1;
+    size_t colon = addr.find(':');
+
+    if (colon != std::string::npos) {
+      bank = std::stoll(addr.substr(0, colon), nullptr, 16);
+      addr = addr.substr(colon + 1);
+    }
+
+    if (addr[0] == '$') {
+      addr = addr.substr(1);
+    }
+
+    uint16_t value = static_cast<uint16_t>(std::stoul(addr, nullptr, 16));
+
+    if (bank >= 0 && value >= 0x8000) {
+      labels[cpu::SAMPLE_ROM + bank * cpu::SAMPLE_PRG_BANK_SIZE +
+             (value % cpu::SAMPLE_PRG_BANK_SIZE)] = name;
+    } else {
+      labels[key(value)] = name;
+    }
+  }
+}
+
+}  // namespace tools
@@ -0,0 +1,38 @@
+#ifndef SRC_TOOLS_SYMBOLS_H_
+#define SRC_TOOLS_SYMBOLS_H_
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <map>
+#include <string>
+
+namespace tools {
+
+/*
+  Code labels keyed like cpu::Sampler keys: CPU addresses below 0x8000 and
+  SAMPLE_ROM plus the PRG-ROM offset above. Labels come from ca65 debug files
+  (.dbg) or from lists of "addr label" lines, where addr is hex with an
+  optional $ or 0x and an optional "bank:" prefix naming a 16K PRG-ROM bank.
+  Addresses without a bank are resolved with `key`, i.e. against the banks
+  mapped in when the file is loaded.
+*/
+class Symbols {
+ public:
+  Symbols(std::function<uint32_t(uint16_t)> key);
+
+  void Load(const std::string& path);
+  // The closest label at or before key in the same bank, or "".
+  std::string Find(uint32_t key) const;
+
+ private:
+  void LoadDbg(std::istream& in);
+  void LoadList(std::istream& in);
+
+  std::function<uint32_t(uint16_t)> key;
+  std::map<uint32_t, std::string> labels;
+};
+
+}  // namespace tools
+
+#endif  // SRC_TOOLS_SYMBOLS_H_
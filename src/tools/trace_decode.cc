@@ -0,0 +1,161 @@
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "src/cpu/opcodes.h"
+#include "src/cpu/trace.h"
+
+/*
+  Turns a trace written by Cpu::StartTrace into a nestest-style log, one
+  line per instruction. Mnemonics and addressing modes are taken from the
+  handler names in opcodes.h.
+*/
+
+struct Instruction {
+  std::string mnemonic;
+  std::string mode;
+};
+
+std::string Upper(std::string name) {
+  for (char& c : name) {
+    c = static_cast<char>(std::toupper(c));
+  }
+  return name;
+}
+
+// "Read<&Cpu::Ora, &Cpu::ZeroPage>", "Immediate<&Cpu::Ora>", "Nop<&Cpu::X>"
+// or a plain handler such as "LdaAbsoluteY" or "Stp".
+Instruction Parse(const std::string& handler) {
+  size_t open = handler.find('<');
+
+  if (open == std::string::npos) {
+    std::string mode = handler.substr(3);
+    return {Upper(handler.substr(0, 3)), mode.empty() ? "Implied" : mode};
+  }
+
+  std::string kind = handler.substr(0, open);
+  std::vector<std::string> args;
+  size_t pos = open;
+
+  while ((pos = handler.find("&Cpu::", pos)) != std::string::npos) {
+    pos += 6;
+    size_t end = handler.find_first_of(",>", pos);
+    args.push_back(handler.substr(pos, end - pos));
+  }
+
+  if (kind == "Nop") {
+    return {"NOP", args[0]};
+  } else if (kind == "Immediate" || kind == "Accumulator") {
+    return {Upper(args[0]), kind};
+  } else {
+    return {Upper(args[0]), args[1]};
+  }
+}
+
+int Length(const std::string& mode) {
+  if (mode == "Implied" || mode == "Accumulator") {
+    return 1;
+  } else if (mode.rfind("Absolute", 0) == 0 || mode == "Indirect") {
+    return 3;
+  } else {
+    return 2;
+  }
+}
+
+std::string Operand(const std::string& mode, const cpu::TraceRecord& record) {
+  uint8_t lo = record.operands[0];
+  uint16_t word = static_cast<uint16_t>(lo) |
+                  (static_cast<uint16_t>(record.operands[1]) << 8);
+  char text[16] = "";
+
+  if (mode == "Accumulator") {
+    return "A";
+  } else if (mode == "Immediate") {
+    std::snprintf(text, sizeof(text), "#$%02X", lo);
+  } else if (mode == "ZeroPage") {
+    std::snprintf(text, sizeof(text), "$%02X", lo);
+  } else if (mode == "ZeroPageX") {
+    std::snprintf(text, sizeof(text), "$%02X,X", lo);
+  } else if (mode == "ZeroPageY") {
+    std::snprintf(text, sizeof(text), "$%02X,Y", lo);
+  } else if (mode == "Absolute") {
+    std::snprintf(text, sizeof(text), "$%04X", word);
+  } else if (mode == "AbsoluteX" || mode == "AbsoluteXW") {
+    std::snprintf(text, sizeof(text), "$%04X,X", word);
+  } else if (mode == "AbsoluteY" || mode == "AbsoluteYW") {
+    std::snprintf(text, sizeof(text), "$%04X,Y", word);
+  } else if (mode == "IndirectX") {
+    std::snprintf(text, sizeof(text), "($%02X,X)", lo);
+  } else if (mode == "IndirectY" || mode == "IndirectYW") {
+    std::snprintf(text, sizeof(text), "($%02X),Y", lo);
+  } else if (mode == "Indirect") {
+    std::snprintf(text, sizeof(text), "($%04X)", word);
+  } else if (mode == "Relative") {
+    uint16_t target = record.PC + 2 + static_cast<int8_t>(lo);
+    std::snprintf(text, sizeof(text), "$%04X", target);
+  }
+
+  return text;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " <trace>" << std::endl;
+    return 1;
+  }
+
+  std::FILE* file = std::fopen(argv[1], "rb");
+
+  if (file == nullptr) {
+    std::cerr << "could not open " << argv[1] << std::endl;
+    return 1;
+  }
+
+  char magic[sizeof(cpu::TRACE_MAGIC)];
+
+  if (std::fread(magic, sizeof(magic), 1, file) != 1 ||
+      std::memcmp(magic, cpu::TRACE_MAGIC, sizeof(magic)) != 0) {
+    std::cerr << argv[1] << " is not a trace file" << std::endl;
+    return 1;
+  }
+
+  std::vector<Instruction> instructions;
+  for (const char* handler : cpu::OPCODE_HANDLERS) {
+    instructions.push_back(Parse(handler));
+  }
+
+  std::vector<cpu::TraceRecord> records(cpu::TRACE_CHUNK_RECORDS);
+  size_t count;
+
+  while ((count = std::fread(records.data(), sizeof(cpu::TraceRecord),
+                             records.size(), file)) > 0) {
+    for (size_t i = 0; i < count; i++) {
+      const cpu::TraceRecord& record = records[i];
+      const Instruction& instruction = instructions[record.opcode];
+      int length = Length(instruction.mode);
+
+      char bytes[12];
+      std::snprintf(bytes, sizeof(bytes), "%02X", record.opcode);
+      for (int j = 1; j < length; j++) {
+        std::snprintf(bytes + 3 * j - 1, sizeof(bytes) - (3 * j - 1), " %02X",
+                      record.operands[j - 1]);
+      }
+
+      std::string text =
+          instruction.mnemonic + " " + Operand(instruction.mode, record);
+
+      std::printf(
+          "%04X  %-8s  %-32sA:%02X X:%02X Y:%02X P:%02X SP:%02X PPU:%3d,%3d "
+          "CYC:%llu\n",
+          record.PC, bytes, text.c_str(), record.A, record.X, record.Y,
+          record.P, record.SP, record.line, record.dot,
+          static_cast<unsigned long long>(record.cycle));
+    }
+  }
+
+  std::fclose(file);
+}